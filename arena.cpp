@@ -0,0 +1,284 @@
+#include "arena.hpp"
+#include "memory.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+static vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    if (alignment <= 1)
+        return value;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+memory_arena create_memory_arena(const vk::PhysicalDeviceMemoryProperties &memory_properties, arena_strategy strategy, vk::DeviceSize block_size)
+{
+    memory_arena arena{};
+    arena.memory_properties = memory_properties;
+    arena.strategy = strategy;
+    arena.block_size = block_size;
+    return arena;
+}
+
+static uint32_t add_block(memory_arena &arena, uint32_t memory_type, vk::DeviceSize size)
+{
+    arena_block block{};
+    block.memory = arena.allocate_block(memory_type, size);
+    block.size = size;
+    block.memory_type = memory_type;
+    block.free_ranges.push_back({0, size});
+    if (arena.map_block && (arena.memory_properties.memoryTypes[memory_type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible))
+        block.mapped = arena.map_block(block.memory, size);
+
+    for (uint32_t i = 0; i < arena.blocks.size(); i++)
+    {
+        if (!arena.blocks[i].memory)
+        {
+            arena.blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    arena.blocks.push_back(std::move(block));
+    return arena.blocks.size() - 1;
+}
+
+// Returns the offset inside the block or UINT64_MAX if it doesnt fit
+static vk::DeviceSize block_allocate(arena_strategy strategy, arena_block &block, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    if (strategy == arena_strategy::linear)
+    {
+        vk::DeviceSize offset = align_up(block.head, alignment);
+        if (offset + size > block.size)
+            return UINT64_MAX;
+        block.head = offset + size;
+        return offset;
+    }
+
+    for (size_t i = 0; i < block.free_ranges.size(); i++)
+    {
+        arena_range range = block.free_ranges[i];
+        vk::DeviceSize offset = align_up(range.offset, alignment);
+        if (offset + size > range.offset + range.size)
+            continue;
+
+        vk::DeviceSize tail = range.offset + range.size - (offset + size);
+        block.free_ranges.erase(block.free_ranges.begin() + i);
+        if (tail > 0)
+            block.free_ranges.insert(block.free_ranges.begin() + i, {offset + size, tail});
+        if (offset > range.offset)
+            block.free_ranges.insert(block.free_ranges.begin() + i, {range.offset, offset - range.offset});
+        return offset;
+    }
+    return UINT64_MAX;
+}
+
+static void block_release(arena_block &block, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    auto it = std::lower_bound(block.free_ranges.begin(), block.free_ranges.end(), offset,
+                                [](const arena_range &range, vk::DeviceSize off) { return range.offset < off; });
+    it = block.free_ranges.insert(it, {offset, size});
+
+    auto next = it + 1;
+    if (next != block.free_ranges.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        block.free_ranges.erase(next);
+    }
+    if (it != block.free_ranges.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset)
+        {
+            prev->size += it->size;
+            block.free_ranges.erase(it);
+        }
+    }
+}
+
+arena_allocation arena_allocate(memory_arena &arena, const vk::MemoryRequirements &requirements,
+                                vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred)
+{
+    int memory_type = find_memory_type(arena.memory_properties, requirements.memoryTypeBits, required, preferred);
+    if (memory_type == -1)
+        throw std::runtime_error("Didnt find a suitable memory");
+
+    arena_allocation allocation{};
+    allocation.size = requirements.size;
+    allocation.alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+    allocation.memory_type = memory_type;
+
+    vk::DeviceSize offset = UINT64_MAX;
+    uint32_t block_index = 0;
+    for (; block_index < arena.blocks.size(); block_index++)
+    {
+        arena_block &block = arena.blocks[block_index];
+        if (!block.memory || block.memory_type != (uint32_t)memory_type)
+            continue;
+        offset = block_allocate(arena.strategy, block, allocation.size, allocation.alignment);
+        if (offset != UINT64_MAX)
+            break;
+    }
+    if (offset == UINT64_MAX)
+    {
+        // Anything bigger than a block gets a block of its own
+        block_index = add_block(arena, memory_type, std::max(arena.block_size, allocation.size));
+        offset = block_allocate(arena.strategy, arena.blocks[block_index], allocation.size, allocation.alignment);
+    }
+
+    arena_block &block = arena.blocks[block_index];
+    block.used += allocation.size;
+    block.allocations++;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.block = block_index;
+    allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+    return allocation;
+}
+
+void arena_free(memory_arena &arena, const arena_allocation &allocation)
+{
+    arena_block &block = arena.blocks[allocation.block];
+    block.used -= allocation.size;
+    block.allocations--;
+    // Linear arenas give the space back on arena_reset
+    if (arena.strategy == arena_strategy::free_list)
+        block_release(block, allocation.offset, allocation.size);
+}
+
+void arena_reset(memory_arena &arena)
+{
+    for (auto &block: arena.blocks)
+    {
+        block.head = 0;
+        block.used = 0;
+        block.allocations = 0;
+        block.free_ranges = {{0, block.size}};
+    }
+}
+
+std::vector<arena_move> arena_defragment(memory_arena &arena, std::vector<arena_allocation *> &allocations)
+{
+    std::vector<arena_move> moves;
+    if (arena.strategy != arena_strategy::free_list)
+        return moves;
+
+    std::vector<arena_allocation *> sorted = allocations;
+    std::sort(sorted.begin(), sorted.end(), [](const arena_allocation *a, const arena_allocation *b) {
+        if (a->memory_type != b->memory_type)
+            return a->memory_type < b->memory_type;
+        if (a->block != b->block)
+            return a->block < b->block;
+        return a->offset < b->offset;
+    });
+
+    // Every block gets rebuilt from scratch out of the live allocations
+    for (auto &block: arena.blocks)
+    {
+        block.used = 0;
+        block.allocations = 0;
+        block.head = 0;
+    }
+    std::vector<std::vector<arena_range>> taken(arena.blocks.size());
+
+    size_t i = 0;
+    while (i < sorted.size())
+    {
+        uint32_t memory_type = sorted[i]->memory_type;
+        uint32_t target = 0;
+        vk::DeviceSize cursor = 0;
+        for (; i < sorted.size() && sorted[i]->memory_type == memory_type; i++)
+        {
+            arena_allocation &a = *sorted[i];
+            vk::DeviceSize offset = 0;
+            // Walk forward through this memory type's blocks until the allocation fits. Packing in order
+            // never passes the allocation's own block since everything before it used to fit there
+            while (true)
+            {
+                arena_block &block = arena.blocks[target];
+                if (block.memory && block.memory_type == memory_type)
+                {
+                    offset = align_up(cursor, a.alignment);
+                    if (offset + a.size <= block.size)
+                        break;
+                }
+                target++;
+                cursor = 0;
+            }
+
+            bool overlaps_self = target == a.block && offset + a.size > a.offset && offset < a.offset;
+            if (overlaps_self)
+            {
+                // Sliding over our own bytes would need a temporary copy, leave it where it is
+                target = a.block;
+                offset = a.offset;
+            }
+            if (target != a.block || offset != a.offset)
+            {
+                moves.push_back({a.memory, a.offset, arena.blocks[target].memory, offset, a.size});
+                a.memory = arena.blocks[target].memory;
+                a.block = target;
+                a.offset = offset;
+                a.mapped = arena.blocks[target].mapped ? arena.blocks[target].mapped + offset : nullptr;
+            }
+            taken[target].push_back({offset, a.size});
+            arena.blocks[target].used += a.size;
+            arena.blocks[target].allocations++;
+            cursor = offset + a.size;
+        }
+    }
+
+    for (uint32_t b = 0; b < arena.blocks.size(); b++)
+    {
+        arena_block &block = arena.blocks[b];
+        if (!block.memory)
+            continue;
+        // Empty blocks can still be the source of a move, arena_trim frees them once the copies are done
+        block.free_ranges.clear();
+        vk::DeviceSize cursor = 0;
+        for (auto &range: taken[b])
+        {
+            if (range.offset > cursor)
+                block.free_ranges.push_back({cursor, range.offset - cursor});
+            cursor = range.offset + range.size;
+        }
+        if (cursor < block.size)
+            block.free_ranges.push_back({cursor, block.size - cursor});
+    }
+    return moves;
+}
+
+void arena_trim(memory_arena &arena)
+{
+    for (auto &block: arena.blocks)
+    {
+        if (block.memory && block.allocations == 0)
+        {
+            arena.free_block(block.memory);
+            block = arena_block{};
+        }
+    }
+}
+
+arena_stats get_arena_stats(const memory_arena &arena)
+{
+    arena_stats stats{};
+    for (auto &block: arena.blocks)
+    {
+        if (!block.memory)
+            continue;
+        stats.reserved += block.size;
+        stats.used += block.used;
+        stats.blocks++;
+        stats.allocations += block.allocations;
+    }
+    return stats;
+}
+
+void destroy_memory_arena(memory_arena &arena)
+{
+    for (auto &block: arena.blocks)
+    {
+        if (block.memory)
+            arena.free_block(block.memory);
+    }
+    arena.blocks.clear();
+}
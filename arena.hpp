@@ -0,0 +1,91 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <functional>
+
+// Hands out aligned sub ranges of big vk::DeviceMemory blocks so we dont need one allocation per buffer.
+// Only buffers should be placed in an arena, so bufferImageGranularity never comes into play.
+// The arena itself never talks to the device, blocks come from the callbacks so it can run on a fake
+// memory properties table
+enum class arena_strategy
+{
+    linear,     // bump allocation, everything is released at once with arena_reset (per frame data)
+    free_list   // first fit with coalescing free ranges (persistent data)
+};
+
+struct arena_allocation
+{
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    vk::DeviceSize alignment;
+    uint32_t memory_type;
+    uint32_t block;
+    char *mapped; // null if the block isnt host visible
+};
+
+struct arena_range
+{
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+};
+
+struct arena_block
+{
+    vk::DeviceMemory memory;
+    vk::DeviceSize size;
+    vk::DeviceSize used;
+    vk::DeviceSize head; // only used by the linear strategy
+    uint32_t memory_type;
+    uint32_t allocations;
+    char *mapped;
+    std::vector<arena_range> free_ranges; // sorted by offset, never adjacent
+};
+
+struct arena_stats
+{
+    vk::DeviceSize reserved;
+    vk::DeviceSize used;
+    uint32_t blocks;
+    uint32_t allocations;
+};
+
+// A memory move produced by defragmentation, the caller copies the bytes and rebinds the resource
+struct arena_move
+{
+    vk::DeviceMemory src_memory;
+    vk::DeviceSize src_offset;
+    vk::DeviceMemory dst_memory;
+    vk::DeviceSize dst_offset;
+    vk::DeviceSize size;
+};
+
+struct memory_arena
+{
+    vk::PhysicalDeviceMemoryProperties memory_properties;
+    arena_strategy strategy;
+    vk::DeviceSize block_size;
+    std::function<vk::DeviceMemory(uint32_t memory_type, vk::DeviceSize size)> allocate_block;
+    std::function<void(vk::DeviceMemory memory)> free_block;
+    std::function<char *(vk::DeviceMemory memory, vk::DeviceSize size)> map_block; // called for host visible blocks
+    std::vector<arena_block> blocks; // freed blocks keep their slot with a null memory so indices stay valid
+};
+
+memory_arena create_memory_arena(const vk::PhysicalDeviceMemoryProperties &memory_properties, arena_strategy strategy, vk::DeviceSize block_size);
+arena_allocation arena_allocate(memory_arena &arena, const vk::MemoryRequirements &requirements,
+                                vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {});
+void arena_free(memory_arena &arena, const arena_allocation &allocation);
+// Linear arenas only, forgets every allocation but keeps the blocks around for the next frame
+void arena_reset(memory_arena &arena);
+// Packs the given live allocations towards the start of their memory type's blocks. allocations has to hold
+// every live allocation of the arena. This only plans the new layout, nothing is copied or rebound here: the
+// allocations are updated in place and the moves are returned in the order the caller has to copy them
+// (vkCmdCopyBuffer, or memmove for mapped blocks), a move never overlaps its own source or the source of a
+// later move. Afterwards every moved resource has to be recreated or rebound at its new offset. The old ranges
+// count as free right away, so finish the copies before the next arena_allocate, then call arena_trim to give
+// the blocks that emptied back
+std::vector<arena_move> arena_defragment(memory_arena &arena, std::vector<arena_allocation *> &allocations);
+// Frees every block without allocations in it
+void arena_trim(memory_arena &arena);
+arena_stats get_arena_stats(const memory_arena &arena);
+void destroy_memory_arena(memory_arena &arena);
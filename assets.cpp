@@ -0,0 +1,584 @@
+#include "assets.hpp"
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <print>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+    // Next whitespace separated token of a netpbm header, comments run to the end of the line
+    std::string_view next_token(const mapped_file &file, size_t &position)
+    {
+        while (position < file.size)
+        {
+            char c = file.data[position];
+            if (c == '#')
+            {
+                while (position < file.size && file.data[position] != '\n')
+                    position++;
+            }
+            else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                position++;
+            else
+                break;
+        }
+        size_t start = position;
+        while (position < file.size && !strchr(" \t\n\r", file.data[position]))
+            position++;
+        return std::string_view(file.data + start, position - start);
+    }
+
+    uint32_t parse_uint(std::string_view token)
+    {
+        if (token.empty() || token.size() > 9 || !std::all_of(token.begin(), token.end(), [](char c){ return c >= '0' && c <= '9'; }))
+            throw std::runtime_error("bad number in the header");
+        return (uint32_t)std::stoul(std::string(token));
+    }
+
+    // Binary netpbm: P6 (RGB) or P7 (PAM, RGB or RGB_ALPHA), 8 bits per channel
+    void decode_texture(const mapped_file &file, decoded_asset &out)
+    {
+        size_t position = 0;
+        std::string_view magic = next_token(file, position);
+        uint32_t width = 0, height = 0, channels = 0, max_value = 0;
+        if (magic == "P6")
+        {
+            width = parse_uint(next_token(file, position));
+            height = parse_uint(next_token(file, position));
+            max_value = parse_uint(next_token(file, position));
+            channels = 3;
+        }
+        else if (magic == "P7")
+        {
+            for (std::string_view key = next_token(file, position); key != "ENDHDR"; key = next_token(file, position))
+            {
+                if (key.empty())
+                    throw std::runtime_error("PAM header never ends");
+                if (key == "WIDTH")
+                    width = parse_uint(next_token(file, position));
+                else if (key == "HEIGHT")
+                    height = parse_uint(next_token(file, position));
+                else if (key == "DEPTH")
+                    channels = parse_uint(next_token(file, position));
+                else if (key == "MAXVAL")
+                    max_value = parse_uint(next_token(file, position));
+                else if (key == "TUPLTYPE")
+                    next_token(file, position);
+            }
+        }
+        else
+            throw std::runtime_error("not a binary ppm or pam");
+        // A single whitespace byte separates the header from the texels
+        position++;
+
+        if (width == 0 || height == 0 || width > 16384 || height > 16384)
+            throw std::runtime_error("bad image size");
+        if (channels != 3 && channels != 4)
+            throw std::runtime_error("only RGB and RGBA images are supported");
+        if (max_value != 255)
+            throw std::runtime_error("only 8 bit images are supported");
+        size_t texel_count = (size_t)width * height;
+        if (position > file.size || file.size - position < texel_count * channels)
+            throw std::runtime_error("file is shorter than its header says");
+
+        out.extent = vk::Extent3D(width, height, 1);
+        out.texels.resize(texel_count);
+        const uint8_t *src = (const uint8_t *)file.data + position;
+        for (size_t i = 0; i < texel_count; i++, src += channels)
+        {
+            uint32_t alpha = channels == 4 ? src[3] : 255;
+            out.texels[i] = src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | alpha << 24;
+        }
+    }
+
+    // Wavefront obj, positions (z is dropped), optional vertex colors after them and polygon faces, everything else is skipped
+    void decode_mesh(const mapped_file &file, decoded_asset &out)
+    {
+        mesh &m = out.geometry;
+        std::string line;
+        size_t position = 0;
+        while (position < file.size)
+        {
+            const char *end = (const char *)memchr(file.data + position, '\n', file.size - position);
+            size_t length = end ? end - (file.data + position) : file.size - position;
+            line.assign(file.data + position, length);
+            position += length + 1;
+
+            const char *cursor = line.c_str();
+            if (line.starts_with("v "))
+            {
+                cursor += 2;
+                float values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+                for (int i = 0; i < 6; i++)
+                {
+                    char *next;
+                    float value = strtof(cursor, &next);
+                    if (next == cursor)
+                        break;
+                    values[i] = value;
+                    cursor = next;
+                }
+                m.vertices.push_back({{values[0], values[1]}, {values[3], values[4], values[5]}});
+            }
+            else if (line.starts_with("f "))
+            {
+                cursor += 2;
+                std::vector<uint32_t> polygon;
+                while (true)
+                {
+                    char *next;
+                    long index = strtol(cursor, &next, 10);
+                    if (next == cursor)
+                        break;
+                    // 1 based, negative counts back from the last vertex
+                    long resolved = index < 0 ? (long)m.vertices.size() + index : index - 1;
+                    if (index == 0 || resolved < 0 || resolved >= (long)m.vertices.size())
+                        throw std::runtime_error("face uses a vertex that doesnt exist");
+                    polygon.push_back((uint32_t)resolved);
+                    // Skip the texture and normal indices
+                    cursor = next;
+                    while (*cursor && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+                        cursor++;
+                }
+                for (size_t i = 2; i < polygon.size(); i++)
+                    m.indices.insert(m.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+            }
+        }
+        if (m.indices.empty())
+            throw std::runtime_error("mesh has no faces");
+    }
+
+    decoded_asset decode_asset_file(const asset_job &job)
+    {
+        profile_zone zone("asset decode");
+        decoded_asset out{};
+        out.handle = job.handle;
+        mapped_file file{};
+        try
+        {
+            file = map_file(job.path);
+            if (job.kind == asset_kind::texture)
+                decode_texture(file, out);
+            else
+                decode_mesh(file, out);
+        }
+        catch (std::exception &e)
+        {
+            out.error = e.what();
+        }
+        unmap_file(file);
+        return out;
+    }
+
+    void asset_worker(asset_loader &loader)
+    {
+        while (true)
+        {
+            asset_job job;
+            {
+                std::unique_lock lock(loader.mutex);
+                loader.work_ready.wait(lock, [&]{ return loader.quit || !loader.jobs.empty(); });
+                if (loader.quit)
+                    return;
+                job = std::move(loader.jobs.front());
+                loader.jobs.pop_front();
+            }
+            decoded_asset result = decode_asset_file(job);
+            std::lock_guard lock(loader.mutex);
+            loader.decoded.push_back(std::move(result));
+        }
+    }
+
+    vk::DeviceSize align_staging(vk::DeviceSize size)
+    {
+        return (size + 15) & ~(vk::DeviceSize)15;
+    }
+
+    // False if the ring is too full right now, the caller tries again next frame
+    bool ring_allocate(staging_ring &ring, vk::DeviceSize size, vk::DeviceSize &offset)
+    {
+        size = align_staging(size);
+        uint64_t start = ring.head;
+        uint64_t position = start % ring.capacity;
+        // Ranges never wrap, the leftover bit at the end is skipped
+        if (position + size > ring.capacity)
+            start += ring.capacity - position;
+        if (start + size - ring.tail > ring.capacity)
+            return false;
+        ring.head = start + size;
+        offset = start % ring.capacity;
+        return true;
+    }
+
+    vk::DeviceSize staging_size(const decoded_asset &asset)
+    {
+        if (!asset.texels.empty())
+            return align_staging(asset.texels.size() * sizeof(uint32_t));
+        size_t index_size = asset.geometry.vertices.size() <= UINT16_MAX ? sizeof(uint16_t) : sizeof(uint32_t);
+        return align_staging(asset.geometry.vertices.size() * sizeof(vertex)) + align_staging(asset.geometry.indices.size() * index_size);
+    }
+
+    vk::ImageMemoryBarrier upload_barrier(vk::Image image, vk::ImageLayout old_layout, vk::ImageLayout new_layout, vk::AccessFlags src_access, vk::AccessFlags dst_access)
+    {
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+        return barrier;
+    }
+}
+
+void init_asset_loader(asset_loader &loader, const vk::Device &device, vk::PhysicalDevice physical_device, vk::Queue queue, uint32_t queue_family,
+                        memory_arena &arena, const std::vector<uint32_t> &queue_families, uint32_t threads, vk::DeviceSize staging_size)
+{
+    loader.device = device;
+    loader.physical_device = physical_device;
+    loader.queue = queue;
+    loader.arena = &arena;
+    loader.queue_families = queue_families;
+    loader.quit = false;
+
+    staging_ring &ring = loader.ring;
+    ring.capacity = align_staging(staging_size);
+    auto staging = create_buffer(device, physical_device, vk::BufferUsageFlagBits::eTransferSrc, ring.capacity);
+    ring.memory = staging.first;
+    ring.buffer = staging.second;
+    ring.data = (char *)device.mapMemory(ring.memory, 0, ring.capacity);
+    ring.head = 0;
+    ring.tail = 0;
+
+    vk::SemaphoreTypeCreateInfo timeline_info(vk::SemaphoreType::eTimeline, 0);
+    vk::SemaphoreCreateInfo semaphore_info;
+    semaphore_info.pNext = &timeline_info;
+    loader.timeline = device.createSemaphore(semaphore_info);
+    loader.timeline_value = 0;
+
+    vk::CommandPoolCreateInfo command_pool_info = {};
+    command_pool_info.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    command_pool_info.queueFamilyIndex = queue_family;
+    loader.command_pool = device.createCommandPool(command_pool_info);
+
+    for (uint32_t i = 0; i < std::max(threads, 1u); i++)
+        loader.workers.emplace_back(asset_worker, std::ref(loader));
+}
+
+static asset_handle request_asset(asset_loader &loader, asset_kind kind, const std::string &path)
+{
+    asset_handle handle = loader.slots.size();
+    asset_slot &slot = loader.slots.emplace_back();
+    slot.kind = kind;
+    slot.state = asset_state::loading;
+    slot.path = path;
+    slot.requested = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(loader.mutex);
+        loader.jobs.push_back({handle, kind, path});
+    }
+    loader.work_ready.notify_one();
+    return handle;
+}
+
+asset_handle load_texture_async(asset_loader &loader, const std::string &path)
+{
+    return request_asset(loader, asset_kind::texture, path);
+}
+
+asset_handle load_mesh_async(asset_loader &loader, const std::string &path)
+{
+    return request_asset(loader, asset_kind::mesh, path);
+}
+
+static void record_texture_upload(asset_loader &loader, vk::CommandBuffer command_buffer, asset_slot &slot, const decoded_asset &asset, vk::DeviceSize offset)
+{
+    const vk::Device &device = loader.device;
+    vk::ImageCreateInfo image_info = {};
+    image_info.imageType = vk::ImageType::e2D;
+    image_info.format = vk::Format::eR8G8B8A8Srgb;
+    image_info.extent = asset.extent;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = vk::SampleCountFlagBits::e1;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+    if (loader.queue_families.size() > 1)
+    {
+        image_info.sharingMode = vk::SharingMode::eConcurrent;
+        image_info.queueFamilyIndexCount = loader.queue_families.size();
+        image_info.pQueueFamilyIndices = loader.queue_families.data();
+    }
+    loaded_texture &texture = slot.texture;
+    texture.extent = asset.extent;
+    texture.image = device.createImage(image_info);
+
+    vk::MemoryRequirements memory_requirements = device.getImageMemoryRequirements(texture.image);
+    int memory_type = find_memory_type(loader.physical_device.getMemoryProperties(), memory_requirements.memoryTypeBits, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (memory_type == -1)
+        throw std::runtime_error("Didnt find a suitable memory for a texture");
+    texture.memory = device.allocateMemory(vk::MemoryAllocateInfo(memory_requirements.size, memory_type));
+    device.bindImageMemory(texture.image, texture.memory, 0);
+
+    vk::ImageViewCreateInfo view_info = {};
+    view_info.image = texture.image;
+    view_info.viewType = vk::ImageViewType::e2D;
+    view_info.format = image_info.format;
+    view_info.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    texture.view = device.createImageView(view_info);
+
+    memcpy(loader.ring.data + offset, asset.texels.data(), asset.texels.size() * sizeof(uint32_t));
+    vk::BufferImageCopy region = {};
+    region.bufferOffset = offset;
+    region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    region.imageExtent = asset.extent;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+                                    upload_barrier(texture.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite));
+    command_buffer.copyBufferToImage(loader.ring.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, region);
+    // Readers only touch it after the CPU saw the timeline pass, same as the staging uploader's fence
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr,
+                                    upload_barrier(texture.image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, {}));
+}
+
+static void record_mesh_upload(asset_loader &loader, vk::CommandBuffer command_buffer, asset_slot &slot, const decoded_asset &asset, vk::DeviceSize offset)
+{
+    const vk::Device &device = loader.device;
+    const mesh &m = asset.geometry;
+    gpu_mesh &ret = slot.mesh;
+    ret.index_count = m.indices.size();
+
+    // Same 16 bit index rule as upload_mesh
+    vk::DeviceSize vertex_size = sizeof(vertex) * m.vertices.size();
+    ret.index_type = m.vertices.size() <= UINT16_MAX ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    vk::DeviceSize index_size = (ret.index_type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)) * m.indices.size();
+
+    // Both buffers exist before any copy is recorded, so a throw leaves nothing in the command buffer pointing at them
+    auto vertex_ret = create_arena_buffer(device, *loader.arena, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                        vertex_size, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, loader.queue_families);
+    ret.vertex_allocation = vertex_ret.first;
+    ret.vertex_buffer = vertex_ret.second;
+    auto index_ret = create_arena_buffer(device, *loader.arena, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                        index_size, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, loader.queue_families);
+    ret.index_allocation = index_ret.first;
+    ret.index_buffer = index_ret.second;
+
+    memcpy(loader.ring.data + offset, m.vertices.data(), vertex_size);
+    command_buffer.copyBuffer(loader.ring.buffer, ret.vertex_buffer, vk::BufferCopy(offset, 0, vertex_size));
+    vk::DeviceSize index_offset = offset + align_staging(vertex_size);
+    if (ret.index_type == vk::IndexType::eUint16)
+    {
+        uint16_t *indices = (uint16_t *)(loader.ring.data + index_offset);
+        for (size_t i = 0; i < m.indices.size(); i++)
+            indices[i] = (uint16_t)m.indices[i];
+    }
+    else
+    {
+        memcpy(loader.ring.data + index_offset, m.indices.data(), index_size);
+    }
+    command_buffer.copyBuffer(loader.ring.buffer, ret.index_buffer, vk::BufferCopy(index_offset, 0, index_size));
+}
+
+// Undoes whatever a record_*_upload that threw got to create, its commands are only recorded once nothing can throw anymore
+static void release_slot(asset_loader &loader, asset_slot &slot)
+{
+    const vk::Device &device = loader.device;
+    if (slot.texture.view)
+        device.destroyImageView(slot.texture.view);
+    if (slot.texture.image)
+        device.destroyImage(slot.texture.image);
+    if (slot.texture.memory)
+        device.freeMemory(slot.texture.memory);
+    if (slot.mesh.vertex_buffer)
+    {
+        device.destroyBuffer(slot.mesh.vertex_buffer);
+        arena_free(*loader.arena, slot.mesh.vertex_allocation);
+    }
+    if (slot.mesh.index_buffer)
+    {
+        device.destroyBuffer(slot.mesh.index_buffer);
+        arena_free(*loader.arena, slot.mesh.index_allocation);
+    }
+    slot.texture = {};
+    slot.mesh = {};
+}
+
+void update_asset_loader(asset_loader &loader)
+{
+    profile_zone zone("asset update");
+    auto now = std::chrono::steady_clock::now();
+    uint64_t completed = loader.device.getSemaphoreCounterValue(loader.timeline);
+    staging_ring &ring = loader.ring;
+    while (!ring.in_flight.empty() && ring.in_flight.front().first <= completed)
+    {
+        ring.tail = ring.in_flight.front().second;
+        ring.in_flight.pop_front();
+    }
+    for (auto &slot: loader.slots)
+    {
+        if (slot.state == asset_state::uploading && slot.upload_value <= completed)
+        {
+            slot.state = asset_state::ready;
+            slot.load_ms = std::chrono::duration<double, std::milli>(now - slot.requested).count();
+        }
+    }
+
+    {
+        std::lock_guard lock(loader.mutex);
+        while (!loader.decoded.empty())
+        {
+            loader.waiting_for_staging.push_back(std::move(loader.decoded.front()));
+            loader.decoded.pop_front();
+        }
+    }
+    if (loader.waiting_for_staging.empty())
+        return;
+
+    // Everything that fits in the ring goes out in one submit, the rest waits for a later frame
+    vk::CommandBuffer command_buffer;
+    uint32_t recorded = 0;
+    uint64_t value = loader.timeline_value + 1;
+    while (!loader.waiting_for_staging.empty())
+    {
+        decoded_asset &asset = loader.waiting_for_staging.front();
+        asset_slot &slot = loader.slots[asset.handle];
+        vk::DeviceSize size = staging_size(asset);
+        if (asset.error.empty() && size > ring.capacity)
+            asset.error = "too big for the staging ring";
+        if (!asset.error.empty())
+        {
+            std::println("Failed to load {}: {}", slot.path, asset.error);
+            slot.state = asset_state::failed;
+            loader.waiting_for_staging.pop_front();
+            continue;
+        }
+        vk::DeviceSize offset;
+        uint64_t ring_head = ring.head;
+        if (!ring_allocate(ring, size, offset))
+            break;
+
+        if (!command_buffer)
+        {
+            auto reusable = std::find_if(loader.command_buffers.begin(), loader.command_buffers.end(), [&](auto &entry){ return entry.second <= completed; });
+            if (reusable == loader.command_buffers.end())
+            {
+                vk::CommandBufferAllocateInfo cmd_alloc_info(loader.command_pool, vk::CommandBufferLevel::ePrimary, 1);
+                loader.command_buffers.push_back({loader.device.allocateCommandBuffers(cmd_alloc_info)[0], 0});
+                reusable = loader.command_buffers.end() - 1;
+            }
+            reusable->second = value;
+            command_buffer = reusable->first;
+            command_buffer.reset();
+            command_buffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        }
+        try
+        {
+            if (slot.kind == asset_kind::texture)
+                record_texture_upload(loader, command_buffer, slot, asset, offset);
+            else
+                record_mesh_upload(loader, command_buffer, slot, asset, offset);
+        }
+        catch (std::exception &e)
+        {
+            // Out of device memory and the like, only this asset fails. The other uploads in the
+            // command buffer still go out, if there are none it goes back to the pool unsubmitted
+            std::println("Failed to upload {}: {}", slot.path, e.what());
+            release_slot(loader, slot);
+            slot.state = asset_state::failed;
+            ring.head = ring_head;
+            loader.waiting_for_staging.pop_front();
+            if (recorded == 0)
+            {
+                command_buffer.reset();
+                std::find_if(loader.command_buffers.begin(), loader.command_buffers.end(), [&](auto &entry){ return entry.first == command_buffer; })->second = 0;
+                command_buffer = nullptr;
+            }
+            continue;
+        }
+        slot.state = asset_state::uploading;
+        slot.upload_value = value;
+        recorded++;
+        loader.waiting_for_staging.pop_front();
+    }
+    if (!command_buffer)
+        return;
+    command_buffer.end();
+
+    vk::TimelineSemaphoreSubmitInfo timeline_info;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &value;
+    vk::SubmitInfo submit_info;
+    submit_info.pNext = &timeline_info;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &loader.timeline;
+    loader.queue.submit(submit_info);
+    ring.in_flight.push_back({value, ring.head});
+    loader.timeline_value = value;
+}
+
+asset_state get_asset_state(const asset_loader &loader, asset_handle handle)
+{
+    return loader.slots[handle].state;
+}
+
+const loaded_texture *get_texture(const asset_loader &loader, asset_handle handle)
+{
+    const asset_slot &slot = loader.slots[handle];
+    return slot.kind == asset_kind::texture && slot.state == asset_state::ready ? &slot.texture : nullptr;
+}
+
+const gpu_mesh *get_mesh(const asset_loader &loader, asset_handle handle)
+{
+    const asset_slot &slot = loader.slots[handle];
+    return slot.kind == asset_kind::mesh && slot.state == asset_state::ready ? &slot.mesh : nullptr;
+}
+
+void destroy_asset_loader(asset_loader &loader)
+{
+    {
+        std::lock_guard lock(loader.mutex);
+        loader.quit = true;
+    }
+    loader.work_ready.notify_all();
+    for (auto &worker: loader.workers)
+        worker.join();
+    loader.workers.clear();
+
+    const vk::Device &device = loader.device;
+    vk::SemaphoreWaitInfo wait_info;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &loader.timeline;
+    wait_info.pValues = &loader.timeline_value;
+    if (device.waitSemaphores(wait_info, UINT64_MAX) != vk::Result::eSuccess)
+        throw std::runtime_error("failed waiting for the asset uploads!");
+
+    for (auto &slot: loader.slots)
+    {
+        // Anything that got as far as uploading owns its resources
+        if (slot.state != asset_state::uploading && slot.state != asset_state::ready)
+            continue;
+        if (slot.kind == asset_kind::texture)
+        {
+            device.destroyImageView(slot.texture.view);
+            device.destroyImage(slot.texture.image);
+            device.freeMemory(slot.texture.memory);
+        }
+        else
+            destroy_gpu_mesh(device, *loader.arena, slot.mesh);
+    }
+    loader.slots.clear();
+    device.destroyCommandPool(loader.command_pool);
+    device.destroySemaphore(loader.timeline);
+    device.unmapMemory(loader.ring.memory);
+    device.destroyBuffer(loader.ring.buffer);
+    device.freeMemory(loader.ring.memory);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "arena.hpp"
+#include "mesh.hpp"
+
+// Loads textures (binary .ppm/.pam) and meshes (.obj) in the background. Worker threads map and decode
+// the files, update_asset_loader copies whatever is decoded into a staging ring and submits it to the
+// transfer queue with a timeline semaphore signal, handles turn ready once the GPU passes that value.
+// Nothing on the render thread ever waits on the disk or the GPU
+enum class asset_kind
+{
+    texture,
+    mesh
+};
+
+enum class asset_state
+{
+    loading,    // queued or being decoded on a worker
+    uploading,  // copies submitted, waiting for the timeline to pass them
+    ready,
+    failed
+};
+
+using asset_handle = uint32_t;
+
+struct loaded_texture
+{
+    vk::Image image;
+    vk::DeviceMemory memory;
+    vk::ImageView view;
+    vk::Extent3D extent;
+};
+
+struct asset_slot
+{
+    asset_kind kind;
+    asset_state state;
+    std::string path;
+    loaded_texture texture;
+    gpu_mesh mesh;
+    uint64_t upload_value;  // timeline value that marks the upload done
+    std::chrono::steady_clock::time_point requested;
+    double load_ms;         // request to ready
+};
+
+struct asset_job
+{
+    asset_handle handle;
+    asset_kind kind;
+    std::string path;
+};
+
+// What a worker hands back, texels are RGBA8 and meshes are already in the engine layout
+struct decoded_asset
+{
+    asset_handle handle;
+    std::vector<uint32_t> texels;
+    vk::Extent3D extent;
+    mesh geometry;
+    std::string error;
+};
+
+// Host visible buffer handed out front to back, a range is reused once the timeline value
+// of the submit that read it has passed
+struct staging_ring
+{
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+    char *data;
+    vk::DeviceSize capacity;
+    uint64_t head;  // both count bytes since creation, head - tail is what is in use
+    uint64_t tail;
+    std::deque<std::pair<uint64_t, uint64_t>> in_flight;   // timeline value, head after that submit
+};
+
+struct asset_loader
+{
+    vk::Device device;
+    vk::PhysicalDevice physical_device;
+    vk::Queue queue;
+    memory_arena *arena;
+    std::vector<uint32_t> queue_families;
+
+    staging_ring ring;
+    vk::Semaphore timeline;
+    uint64_t timeline_value;
+    vk::CommandPool command_pool;
+    std::vector<std::pair<vk::CommandBuffer, uint64_t>> command_buffers;   // reusable once the timeline passes the value
+
+    // Only touched by the thread calling update, handles index into it
+    std::deque<asset_slot> slots;
+    std::deque<decoded_asset> waiting_for_staging;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::deque<asset_job> jobs;
+    std::deque<decoded_asset> decoded;
+    bool quit;
+};
+
+// queue must be usable for transfers and only used from the thread that calls update_asset_loader.
+// Every resource is shared between queue_families like the other static buffers
+void init_asset_loader(asset_loader &loader, const vk::Device &device, vk::PhysicalDevice physical_device, vk::Queue queue, uint32_t queue_family,
+                        memory_arena &arena, const std::vector<uint32_t> &queue_families, uint32_t threads, vk::DeviceSize staging_size);
+asset_handle load_texture_async(asset_loader &loader, const std::string &path);
+asset_handle load_mesh_async(asset_loader &loader, const std::string &path);
+// Call once per frame, it only does what can be done without waiting
+void update_asset_loader(asset_loader &loader);
+asset_state get_asset_state(const asset_loader &loader, asset_handle handle);
+// nullptr until the asset is ready
+const loaded_texture *get_texture(const asset_loader &loader, asset_handle handle);
+const gpu_mesh *get_mesh(const asset_loader &loader, asset_handle handle);
+// Stops the workers and waits for the uploads still in flight before freeing everything
+void destroy_asset_loader(asset_loader &loader);
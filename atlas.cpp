@@ -0,0 +1,122 @@
+#include "atlas.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+texture_atlas create_texture_atlas(uint32_t page_size, uint32_t padding)
+{
+    texture_atlas atlas{};
+    atlas.page_size = page_size;
+    atlas.padding = padding;
+    return atlas;
+}
+
+static void add_page(texture_atlas &atlas)
+{
+    atlas.pages.emplace_back(atlas.page_size * atlas.page_size, 0);
+    atlas.skylines.push_back({{0, 0, atlas.page_size}});
+}
+
+// Lowest y a width wide rect can sit at when its left edge is on node index, UINT32_MAX if it runs off the page
+static uint32_t skyline_fit(const std::vector<skyline_node> &skyline, size_t index, uint32_t width, uint32_t height, uint32_t page_size)
+{
+    uint32_t x = skyline[index].x;
+    if (x + width > page_size)
+        return UINT32_MAX;
+    uint32_t y = 0;
+    uint32_t remaining = width;
+    for (size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + height > page_size)
+            return UINT32_MAX;
+        remaining -= std::min(remaining, skyline[i].width);
+    }
+    return y;
+}
+
+static void skyline_insert(std::vector<skyline_node> &skyline, size_t index, uint32_t x, uint32_t y, uint32_t width)
+{
+    skyline.insert(skyline.begin() + index, {x, y, width});
+    // Everything the new node covers is cut off the nodes after it
+    for (size_t i = index + 1; i < skyline.size();)
+    {
+        uint32_t end = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= end)
+            break;
+        uint32_t shrink = end - skyline[i].x;
+        if (shrink >= skyline[i].width)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+        break;
+    }
+    // Neighbours at the same height become one step
+    for (size_t i = 0; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+            continue;
+        }
+        i++;
+    }
+}
+
+atlas_rect atlas_pack(texture_atlas &atlas, uint32_t width, uint32_t height)
+{
+    uint32_t padded_width = width + atlas.padding;
+    uint32_t padded_height = height + atlas.padding;
+    if (padded_width > atlas.page_size || padded_height > atlas.page_size)
+        throw std::runtime_error("Image is bigger than an atlas page");
+
+    for (uint32_t page = 0; ; page++)
+    {
+        if (page == atlas.pages.size())
+            add_page(atlas);
+        std::vector<skyline_node> &skyline = atlas.skylines[page];
+
+        // Bottom left: lowest top edge wins, ties go to the narrowest step so wide gaps stay open
+        size_t best_index = SIZE_MAX;
+        uint32_t best_y = UINT32_MAX;
+        uint32_t best_width = UINT32_MAX;
+        for (size_t i = 0; i < skyline.size(); i++)
+        {
+            uint32_t y = skyline_fit(skyline, i, padded_width, padded_height, atlas.page_size);
+            if (y == UINT32_MAX)
+                continue;
+            if (y + padded_height < best_y || (y + padded_height == best_y && skyline[i].width < best_width))
+            {
+                best_index = i;
+                best_y = y + padded_height;
+                best_width = skyline[i].width;
+            }
+        }
+        if (best_index == SIZE_MAX)
+            continue;
+
+        uint32_t x = skyline[best_index].x;
+        uint32_t y = best_y - padded_height;
+        skyline_insert(skyline, best_index, x, best_y, padded_width);
+        return {page, x, y, width, height};
+    }
+}
+
+sprite_region atlas_add_image(texture_atlas &atlas, const uint32_t *pixels, uint32_t width, uint32_t height)
+{
+    atlas_rect rect = atlas_pack(atlas, width, height);
+    std::vector<uint32_t> &page = atlas.pages[rect.page];
+    for (uint32_t row = 0; row < height; row++)
+        memcpy(&page[(rect.y + row) * atlas.page_size + rect.x], pixels + row * width, width * sizeof(uint32_t));
+
+    float size = (float)atlas.page_size;
+    sprite_region region;
+    region.page = rect.page;
+    region.uv_min = glm::vec2(rect.x / size, rect.y / size);
+    region.uv_max = glm::vec2((rect.x + width) / size, (rect.y + height) / size);
+    return region;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+struct atlas_rect
+{
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Where an image ended up, uvs cover exactly its pixels (without the padding)
+struct sprite_region
+{
+    uint32_t page;
+    glm::vec2 uv_min;
+    glm::vec2 uv_max;
+};
+
+// One step of a page's skyline, the packed area below it is full
+struct skyline_node
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+};
+
+// Square RGBA8 pages filled with a skyline bottom left packer, a new page is opened whenever
+// an image doesnt fit in any of the current ones
+struct texture_atlas
+{
+    uint32_t page_size;
+    uint32_t padding;
+    std::vector<std::vector<uint32_t>> pages;
+    std::vector<std::vector<skyline_node>> skylines;
+};
+
+texture_atlas create_texture_atlas(uint32_t page_size, uint32_t padding = 1);
+// Reserves width x height texels (plus padding), throws if it could never fit in a page
+atlas_rect atlas_pack(texture_atlas &atlas, uint32_t width, uint32_t height);
+// Packs the image and copies its pixels (RGBA8, rows tightly packed) into the page
+sprite_region atlas_add_image(texture_atlas &atlas, const uint32_t *pixels, uint32_t width, uint32_t height);
@@ -0,0 +1,715 @@
+#include "benchmark.hpp"
+#include "entities.hpp"
+#include "broadphase.hpp"
+#include "atlas.hpp"
+#include "waves.hpp"
+#include "frame_graph.hpp"
+#include "memory.hpp"
+#include "random.hpp"
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <cmath>
+#include <print>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+void frame_stats::reserve(size_t frames)
+{
+    cpu_record.reserve(frames);
+    submit_to_fence.reserve(frames);
+    frame_time.reserve(frames);
+    bytes_streamed.reserve(frames);
+}
+
+void frame_stats::add_frame(double cpu_record_ms, double submit_to_fence_ms, double frame_ms, uint64_t streamed)
+{
+    cpu_record.push_back(cpu_record_ms);
+    submit_to_fence.push_back(submit_to_fence_ms);
+    frame_time.push_back(frame_ms);
+    bytes_streamed.push_back(streamed);
+}
+
+// Nearest rank percentile, p goes from 0 to 100
+double percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty())
+        return 0.0;
+    size_t rank = (size_t)std::ceil((p / 100.0) * samples.size());
+    rank = std::clamp(rank, (size_t)1, samples.size());
+    std::nth_element(samples.begin(), samples.begin() + (rank - 1), samples.end());
+    return samples[rank - 1];
+}
+
+static void print_row(const char *name, const std::vector<double> &samples)
+{
+    if (samples.empty())
+    {
+        std::println("{:<16} no samples", name);
+        return;
+    }
+    double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double min = *std::min_element(samples.begin(), samples.end());
+    double max = *std::max_element(samples.begin(), samples.end());
+    std::println("{:<16} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}", name, min, avg,
+                percentile(samples, 50.0), percentile(samples, 95.0), percentile(samples, 99.0), max);
+}
+
+void frame_stats::report() const
+{
+    std::println("Benchmark over {} frames with {} frames in flight (ms)", frame_time.size(), frames_in_flight);
+    std::println("{:<16} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}", "", "min", "avg", "p50", "p95", "p99", "max");
+    print_row("cpu record", cpu_record);
+    print_row("submit->fence", submit_to_fence);
+    print_row("frame time", frame_time);
+    if (!frame_time.empty())
+    {
+        double total = std::accumulate(frame_time.begin(), frame_time.end(), 0.0);
+        std::println("Average fps {:.1f}", frame_time.size() / (total / 1000.0));
+    }
+    if (!bytes_streamed.empty())
+    {
+        uint64_t total_bytes = std::accumulate(bytes_streamed.begin(), bytes_streamed.end(), (uint64_t)0);
+        uint64_t max_bytes = *std::max_element(bytes_streamed.begin(), bytes_streamed.end());
+        std::println("Streamed {} bytes per frame on average, {} at most", total_bytes / bytes_streamed.size(), max_bytes);
+    }
+}
+
+static entity_store make_benchmark_store(size_t count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    entity_store store;
+    reserve_entities(store, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bounding_box box{dist(rng), dist(rng), 0.05f, 0.05f, dist(rng), dist(rng), dist(rng), dist(rng)};
+        add_entity(store, box, glm::vec3(1.0f));
+    }
+    return store;
+}
+
+// Best of a few runs, returns milliseconds per step
+template <typename F>
+static double time_steps(entity_store &store, uint32_t steps, F integrate)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    double best = 1e30;
+    for (int run = 0; run < 3; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < steps; i++)
+            integrate(store, 1.0f / 600.0f);
+        best = std::min(best, ms(std::chrono::steady_clock::now() - start).count() / steps);
+    }
+    return best;
+}
+
+bool run_physics_benchmark()
+{
+    bool correct = true;
+    std::println("Physics integration benchmark, vector path is {}", integrator_name());
+    std::println("{:>10} {:>14} {:>14} {:>16} {:>8}", "entities", "scalar ms", "vector ms", "Mentities/s", "speedup");
+    for (size_t count: {(size_t)1000, (size_t)100000, (size_t)1000000})
+    {
+        uint32_t steps = (uint32_t)std::max((size_t)10, (size_t)10000000 / count);
+        entity_store scalar_store = make_benchmark_store(count);
+        entity_store vector_store = make_benchmark_store(count);
+        double scalar_ms = time_steps(scalar_store, steps, [](entity_store &s, float t) { integrate_entities_scalar(s, t); });
+        double vector_ms = time_steps(vector_store, steps, [](entity_store &s, float t) { integrate_entities(s, t); });
+
+        // Same operations in the same order, only fma contraction in the scalar loop can make them differ
+        float max_error = 0.0f;
+        for (size_t i = 0; i < count; i++)
+        {
+            max_error = std::max(max_error, std::abs(scalar_store.x[i] - vector_store.x[i]));
+            max_error = std::max(max_error, std::abs(scalar_store.y[i] - vector_store.y[i]));
+        }
+        if (max_error > 1e-3f)
+        {
+            std::println("Vector integrator diverged from the scalar one at {} entities!", count);
+            correct = false;
+        }
+        std::println("{:>10} {:>14.4f} {:>14.4f} {:>16.1f} {:>7.2f}x", count, scalar_ms, vector_ms,
+                    count / (vector_ms * 1000.0), scalar_ms / vector_ms);
+    }
+    std::println(correct ? "Vector integrator matches the scalar one" : "Physics check FAILED");
+    return correct;
+}
+
+static entity_store make_broadphase_store(size_t count)
+{
+    // Keep the density about the same at every size so the pair count grows linearly
+    float extent = 0.5f / std::sqrt((float)count);
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> pos(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> size(0.5f * extent, 1.5f * extent);
+    std::uniform_real_distribution<float> vel(-0.5f, 0.5f);
+    entity_store store;
+    reserve_entities(store, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bounding_box box{pos(rng), pos(rng), size(rng), size(rng), vel(rng), vel(rng), 0.0f, 0.0f};
+        add_entity(store, box, glm::vec3(1.0f));
+    }
+    return store;
+}
+
+static void sort_pairs(std::vector<collision_pair> &pairs)
+{
+    std::sort(pairs.begin(), pairs.end(), [](const collision_pair &l, const collision_pair &r) {
+        return l.a != r.a ? l.a < r.a : l.b < r.b;
+    });
+}
+
+static bool same_pairs(std::vector<collision_pair> l, std::vector<collision_pair> r)
+{
+    sort_pairs(l);
+    sort_pairs(r);
+    return std::equal(l.begin(), l.end(), r.begin(), r.end(), [](const collision_pair &x, const collision_pair &y) {
+        return x.a == y.a && x.b == y.b;
+    });
+}
+
+bool run_broadphase_benchmark()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    bool correct = true;
+    std::println("{:>10} {:>10} {:>12} {:>12} {:>14}", "boxes", "pairs", "grid ms", "sap ms", "brute ms");
+    for (size_t count: {(size_t)1000, (size_t)10000, (size_t)100000})
+    {
+        entity_store store = make_broadphase_store(count);
+        broadphase grid;
+        grid.method = broadphase_method::grid;
+        broadphase sap;
+        sap.method = broadphase_method::sweep_and_prune;
+        std::vector<collision_pair> brute;
+        bool check = count <= 10000;
+
+        const int steps = 10;
+        double grid_ms = 0.0, sap_ms = 0.0, brute_ms = 0.0;
+        size_t pairs = 0;
+        for (int step = 0; step < steps; step++)
+        {
+            integrate_entities(store, 1.0f / 60.0f);
+
+            auto start = std::chrono::steady_clock::now();
+            find_pairs(grid, store);
+            auto mid = std::chrono::steady_clock::now();
+            find_pairs(sap, store);
+            auto end = std::chrono::steady_clock::now();
+            grid_ms += ms(mid - start).count();
+            sap_ms += ms(end - mid).count();
+            pairs += grid.pairs.size();
+
+            if (!same_pairs(grid.pairs, sap.pairs))
+            {
+                std::println("Grid and sweep and prune disagree at {} boxes ({} vs {} pairs)", count, grid.pairs.size(), sap.pairs.size());
+                correct = false;
+            }
+            if (check)
+            {
+                auto brute_start = std::chrono::steady_clock::now();
+                find_pairs_brute_force(store, brute);
+                brute_ms += ms(std::chrono::steady_clock::now() - brute_start).count();
+                if (!same_pairs(grid.pairs, brute))
+                {
+                    std::println("Grid disagrees with brute force at {} boxes ({} vs {} pairs)", count, grid.pairs.size(), brute.size());
+                    correct = false;
+                }
+            }
+        }
+        if (check)
+            std::println("{:>10} {:>10} {:>12.3f} {:>12.3f} {:>14.3f}", count, pairs / steps, grid_ms / steps, sap_ms / steps, brute_ms / steps);
+        else
+            std::println("{:>10} {:>10} {:>12.3f} {:>12.3f} {:>14}", count, pairs / steps, grid_ms / steps, sap_ms / steps, "skipped");
+    }
+    std::println(correct ? "All broad phase results match" : "Broad phase results DONT match");
+    return correct;
+}
+
+bool run_spawn_benchmark()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    // Fast boxes that die halfway across, at most 48 frames worth of each wave are ever alive
+    const size_t capacity = 250000;
+    enemy_archetype archetype = default_enemy_archetype();
+    archetype.speed = {1.0f, 2.0f};
+    const int frames = 600;
+    bool correct = true;
+    std::println("{:>12} {:>10} {:>10} {:>10} {:>10}", "per frame", "alive", "avg ms", "p99 ms", "reallocs");
+    for (uint32_t per_frame: {100u, 1000u, 5000u})
+    {
+        entity_pool pool;
+        init_entity_pool(pool, capacity);
+        pcg32 rng = make_rng(per_frame);
+        wave_scheduler scheduler{};
+        scheduler.waves = {{0.0f, per_frame, 0.0f, false, archetype}};
+        scheduler.growth = 1.0f;
+        scheduler.multiplier = 1.0f;
+
+        // Every column and table keeps its buffer if nothing allocated
+        const float *x_data = pool.store.x.data();
+        const uint32_t *slot_data = pool.dense_to_slot.data();
+        uint32_t reallocations = 0;
+        std::vector<double> samples;
+        samples.reserve(frames);
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            update_wave_scheduler(scheduler, 1.0f / 60.0f, rng, pool);
+            integrate_entities(pool.store, 1.0f / 60.0f);
+            for (size_t i = 0; i < pool.store.size();)
+            {
+                if (pool.store.x[i] < 0.0f)
+                {
+                    despawn_entity_at(pool, i);
+                    continue;
+                }
+                i++;
+            }
+            samples.push_back(ms(std::chrono::steady_clock::now() - start).count());
+            if (pool.store.x.data() != x_data || pool.dense_to_slot.data() != slot_data)
+            {
+                reallocations++;
+                x_data = pool.store.x.data();
+                slot_data = pool.dense_to_slot.data();
+            }
+        }
+        for (size_t i = 0; i < pool.store.size(); i++)
+        {
+            if (entity_index(pool, entity_handle_at(pool, i)) != i)
+            {
+                std::println("Handle of entity {} doesnt lead back to it", i);
+                correct = false;
+                break;
+            }
+        }
+        double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        std::println("{:>12} {:>10} {:>10.3f} {:>10.3f} {:>10}", per_frame, pool.store.size(), avg, percentile(samples, 99.0), reallocations);
+        if (reallocations > 0)
+            correct = false;
+    }
+    std::println(correct ? "Pool handles are consistent and it never reallocated" : "Entity pool check FAILED");
+    return correct;
+}
+
+bool run_atlas_benchmark()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    bool correct = true;
+    std::println("{:>10} {:>10} {:>7} {:>10} {:>12}", "sprites", "max size", "pages", "occupancy", "pack ms");
+    for (uint32_t max_size: {16u, 64u, 256u})
+    {
+        const uint32_t count = 4096;
+        texture_atlas atlas = create_texture_atlas(1024);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<uint32_t> size(1, max_size);
+        std::vector<atlas_rect> rects(count);
+        auto start = std::chrono::steady_clock::now();
+        for (auto &rect: rects)
+            rect = atlas_pack(atlas, size(rng), size(rng));
+        double pack_ms = ms(std::chrono::steady_clock::now() - start).count();
+
+        // Padding counts as part of the rect, neighbours must not even touch it
+        uint64_t area = 0;
+        for (uint32_t i = 0; i < count && correct; i++)
+        {
+            const atlas_rect &a = rects[i];
+            area += (uint64_t)(a.width + atlas.padding) * (a.height + atlas.padding);
+            if (a.x + a.width + atlas.padding > atlas.page_size || a.y + a.height + atlas.padding > atlas.page_size)
+            {
+                std::println("Rect {} leaves its page", i);
+                correct = false;
+            }
+            for (uint32_t j = i + 1; j < count; j++)
+            {
+                const atlas_rect &b = rects[j];
+                if (a.page == b.page && a.x < b.x + b.width + atlas.padding && b.x < a.x + a.width + atlas.padding
+                    && a.y < b.y + b.height + atlas.padding && b.y < a.y + a.height + atlas.padding)
+                {
+                    std::println("Rects {} and {} overlap on page {}", i, j, a.page);
+                    correct = false;
+                    break;
+                }
+            }
+        }
+        double occupancy = (double)area / ((double)atlas.pages.size() * atlas.page_size * atlas.page_size);
+        std::println("{:>10} {:>10} {:>7} {:>9.1f}% {:>12.3f}", count, max_size, atlas.pages.size(), occupancy * 100.0, pack_ms);
+    }
+    std::println(correct ? "Atlas packing is valid" : "Atlas packing is BROKEN");
+    return correct;
+}
+
+// Three memory types like a discrete GPU has, blocks live in host vectors so moves can be checked byte by byte
+static memory_arena create_fake_arena(arena_strategy strategy, std::vector<std::vector<char>> &storage)
+{
+    vk::PhysicalDeviceMemoryProperties properties = {};
+    properties.memoryTypeCount = 3;
+    properties.memoryTypes[0].propertyFlags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    properties.memoryTypes[1].propertyFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    properties.memoryTypes[2].propertyFlags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible
+                                                | vk::MemoryPropertyFlagBits::eHostCoherent;
+    memory_arena arena = create_memory_arena(properties, strategy, 1024 * 1024);
+    // Handle n is storage[n - 1], an empty vector is a freed block
+    arena.allocate_block = [&storage](uint32_t, vk::DeviceSize size)
+    {
+        storage.emplace_back(size);
+        return vk::DeviceMemory((VkDeviceMemory)(uintptr_t)storage.size());
+    };
+    arena.free_block = [&storage](vk::DeviceMemory memory)
+    {
+        storage[(uintptr_t)(VkDeviceMemory)memory - 1] = {};
+    };
+    arena.map_block = [&storage](vk::DeviceMemory memory, vk::DeviceSize)
+    {
+        return storage[(uintptr_t)(VkDeviceMemory)memory - 1].data();
+    };
+    return arena;
+}
+
+static bool allocations_overlap(const arena_allocation &a, const arena_allocation &b)
+{
+    return a.memory == b.memory && a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+bool run_arena_benchmark()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    bool correct = true;
+    auto check = [&](bool ok, const char *what)
+    {
+        if (!ok)
+            std::println("Arena check failed: {}", what);
+        correct = correct && ok;
+    };
+
+    // Memory type choice follows memoryTypeBits first, then the preferred flags
+    std::vector<std::vector<char>> storage;
+    memory_arena arena = create_fake_arena(arena_strategy::free_list, storage);
+    const vk::MemoryPropertyFlags host = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    check(find_memory_type(arena.memory_properties, 0b111, host, vk::MemoryPropertyFlagBits::eDeviceLocal) == 2, "prefers device local host memory");
+    check(find_memory_type(arena.memory_properties, 0b011, host, vk::MemoryPropertyFlagBits::eDeviceLocal) == 1, "falls back when the preferred type is masked");
+    check(find_memory_type(arena.memory_properties, 0b010, vk::MemoryPropertyFlagBits::eDeviceLocal) == -1, "rejects types without the required flags");
+    arena_allocation device_local = arena_allocate(arena, {256, 16, 0b001}, {});
+    check(device_local.memory_type == 0 && device_local.mapped == nullptr, "device local blocks stay unmapped");
+    arena_free(arena, device_local);
+
+    // Random sizes and alignments, every offset aligned and nothing overlapping
+    pcg32 rng = make_rng(4);
+    std::vector<arena_allocation> allocations;
+    for (int i = 0; i < 2000; i++)
+    {
+        vk::DeviceSize size = 1 + next_u32(rng) % 20000;
+        vk::DeviceSize alignment = vk::DeviceSize(1) << (next_u32(rng) % 9);
+        allocations.push_back(arena_allocate(arena, {size, alignment, 0b110}, host, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    }
+    for (size_t i = 0; i < allocations.size() && correct; i++)
+    {
+        check(allocations[i].offset % allocations[i].alignment == 0, "offsets honour the alignment");
+        check(allocations[i].memory_type == 2 && allocations[i].mapped, "host allocations are mapped");
+        for (size_t j = i + 1; j < allocations.size() && correct; j++)
+            check(!allocations_overlap(allocations[i], allocations[j]), "allocations dont overlap");
+    }
+
+    // Free every other one, fill the rest with a pattern and defragment: after running the moves in order
+    // every allocation has to find its own bytes at its new place
+    std::vector<arena_allocation> live;
+    for (size_t i = 0; i < allocations.size(); i++)
+    {
+        if (i % 2 == 0)
+            arena_free(arena, allocations[i]);
+        else
+            live.push_back(allocations[i]);
+    }
+    for (size_t i = 0; i < live.size(); i++)
+        memset(live[i].mapped, (int)(i % 251) + 1, live[i].size);
+    arena_stats before = get_arena_stats(arena);
+    std::vector<arena_allocation *> pointers;
+    for (auto &allocation: live)
+        pointers.push_back(&allocation);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<arena_move> moves = arena_defragment(arena, pointers);
+    double defragment_ms = ms(std::chrono::steady_clock::now() - start).count();
+    for (const arena_move &move: moves)
+    {
+        char *src = storage[(uintptr_t)(VkDeviceMemory)move.src_memory - 1].data() + move.src_offset;
+        char *dst = storage[(uintptr_t)(VkDeviceMemory)move.dst_memory - 1].data() + move.dst_offset;
+        memmove(dst, src, move.size);
+    }
+    arena_trim(arena);
+    arena_stats after = get_arena_stats(arena);
+    for (size_t i = 0; i < live.size() && correct; i++)
+    {
+        const char *bytes = storage[(uintptr_t)(VkDeviceMemory)live[i].memory - 1].data() + live[i].offset;
+        check(live[i].mapped == bytes, "moved allocations point at their new mapping");
+        check(std::all_of(bytes, bytes + live[i].size, [&](char c) { return c == (char)(i % 251 + 1); }), "moves carry the data");
+        check(live[i].offset % live[i].alignment == 0, "moved allocations stay aligned");
+    }
+    check(after.used == before.used && after.reserved <= before.reserved, "defragment keeps every byte and never grows");
+    std::println("Defragment: {} moves in {:.3f} ms, {} blocks {} KiB reserved -> {} blocks {} KiB", moves.size(), defragment_ms,
+                before.blocks, before.reserved / 1024, after.blocks, after.reserved / 1024);
+    destroy_memory_arena(arena);
+
+    // Linear arenas bump allocate and start over on reset without asking for new blocks
+    std::vector<std::vector<char>> linear_storage;
+    memory_arena linear = create_fake_arena(arena_strategy::linear, linear_storage);
+    const int frames = 100;
+    const int per_frame = 1000;
+    std::vector<vk::DeviceSize> first_frame;
+    start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        arena_reset(linear);
+        vk::DeviceSize previous_end = 0;
+        for (int i = 0; i < per_frame; i++)
+        {
+            arena_allocation allocation = arena_allocate(linear, {vk::DeviceSize(64 + i % 7 * 100), 64, 0b001}, {});
+            if (frame == 0)
+                first_frame.push_back(allocation.offset);
+            else if (allocation.offset != first_frame[i])
+                check(false, "a reset linear arena hands out the same offsets again");
+            if (allocation.block == 0)
+            {
+                check(allocation.offset >= previous_end && allocation.offset % 64 == 0, "linear allocations bump forward aligned");
+                previous_end = allocation.offset + allocation.size;
+            }
+        }
+    }
+    double linear_ms = ms(std::chrono::steady_clock::now() - start).count();
+    check(first_frame[0] == 0, "reset starts at the front");
+    check(linear_storage.size() == get_arena_stats(linear).blocks, "reset never allocates new blocks");
+    std::println("Linear: {} allocations per frame in {:.4f} ms, {} blocks after {} frames", per_frame, linear_ms / frames,
+                get_arena_stats(linear).blocks, frames);
+    destroy_memory_arena(linear);
+
+    std::println(correct ? "Arena memory types, alignment, reset and defragment are valid" : "Arena check FAILED");
+    return correct;
+}
+
+// Deferred style frame, a debug view at the end that nothing presents gets culled
+static void build_synthetic_graph(frame_graph &graph)
+{
+    const vk::Extent2D screen = {1920, 1080};
+    begin_graph(graph);
+    graph_handle target = import_image(graph, "swapchain", {}, {}, graph_access::acquired, graph_access::present);
+    graph_handle instances = import_buffer(graph, "instances", {}, graph_access::none, graph_access::none);
+    graph_handle visible = create_graph_buffer(graph, "visible instances", 16 << 20);
+    graph_handle shadow = create_graph_image(graph, "shadow map", vk::Format::eD32Sfloat, {2048, 2048});
+    graph_handle albedo = create_graph_image(graph, "albedo", vk::Format::eR8G8B8A8Unorm, screen);
+    graph_handle normal = create_graph_image(graph, "normal", vk::Format::eR16G16B16A16Sfloat, screen);
+    graph_handle depth = create_graph_image(graph, "depth", vk::Format::eD32Sfloat, screen);
+    graph_handle hdr = create_graph_image(graph, "hdr", vk::Format::eR16G16B16A16Sfloat, screen);
+    graph_handle debug = create_graph_image(graph, "debug view", vk::Format::eR8G8B8A8Unorm, screen);
+
+    add_graph_pass(graph, "cull", {{instances, graph_access::compute_read}, {visible, graph_access::compute_write}}, {});
+    add_graph_pass(graph, "shadow", {{visible, graph_access::vertex_read}, {shadow, graph_access::depth_write}}, {});
+    add_graph_pass(graph, "gbuffer", {{visible, graph_access::vertex_read}, {albedo, graph_access::color_write},
+                                      {normal, graph_access::color_write}, {depth, graph_access::depth_write}}, {});
+    add_graph_pass(graph, "lighting", {{albedo, graph_access::fragment_sample}, {normal, graph_access::fragment_sample},
+                                       {depth, graph_access::fragment_sample}, {shadow, graph_access::fragment_sample},
+                                       {hdr, graph_access::color_write}}, {});
+    graph_handle bloom = hdr;
+    vk::Extent2D extent = screen;
+    for (int level = 1; level <= 4; level++)
+    {
+        extent = {extent.width / 2, extent.height / 2};
+        graph_handle down = create_graph_image(graph, std::format("bloom {}", level), vk::Format::eR16G16B16A16Sfloat, extent);
+        add_graph_pass(graph, std::format("bloom down {}", level), {{bloom, graph_access::fragment_sample}, {down, graph_access::color_write}}, {});
+        bloom = down;
+    }
+    add_graph_pass(graph, "tonemap", {{hdr, graph_access::fragment_sample}, {bloom, graph_access::fragment_sample},
+                                      {target, graph_access::color_write}}, {});
+    add_graph_pass(graph, "debug view", {{depth, graph_access::fragment_sample}, {debug, graph_access::color_write}}, {});
+}
+
+// Roughly what a desktop driver asks for, 64KiB aligned images that can live in one memory type
+static vk::MemoryRequirements estimate_requirements(graph_resource &resource)
+{
+    vk::DeviceSize bytes = resource.size;
+    if (resource.image)
+    {
+        uint32_t texel = resource.format == vk::Format::eR16G16B16A16Sfloat ? 8 : 4;
+        bytes = (vk::DeviceSize)resource.extent.width * resource.extent.height * texel;
+    }
+    vk::MemoryRequirements requirements = {};
+    requirements.size = (bytes + 65535) / 65536 * 65536;
+    requirements.alignment = 65536;
+    requirements.memoryTypeBits = 1;
+    return requirements;
+}
+
+// Barriers compile_graph has to come up with for the synthetic graph, in pass order
+struct expected_barriers
+{
+    const char *pass;
+    size_t count;
+};
+
+static bool check_graph_barriers(const frame_graph &graph)
+{
+    static const expected_barriers expected[] = {
+        {"cull", 0}, {"shadow", 2}, {"gbuffer", 3}, {"lighting", 5}, {"bloom down 1", 2},
+        {"bloom down 2", 2}, {"bloom down 3", 2}, {"bloom down 4", 2}, {"tonemap", 2},
+    };
+    bool correct = true;
+    if (graph.order.size() != std::size(expected))
+    {
+        std::println("Expected {} passes after culling, got {}", std::size(expected), graph.order.size());
+        return false;
+    }
+    for (uint32_t position = 0; position < graph.order.size(); position++)
+    {
+        const graph_pass &pass = graph.passes[graph.order[position]];
+        size_t count = pass.image_barriers.size() + pass.buffer_barriers.size();
+        if (pass.name != expected[position].pass || count != expected[position].count)
+        {
+            std::println("Pass {} at {} has {} barriers, expected {} with {}", pass.name, position, count, expected[position].pass,
+                        expected[position].count);
+            correct = false;
+        }
+        for (size_t i = 0; i < pass.image_barriers.size(); i++)
+        {
+            const vk::ImageMemoryBarrier2 &barrier = pass.image_barriers[i];
+            const graph_resource &resource = graph.resources[pass.barrier_resources[i]];
+            auto use = std::find_if(pass.uses.begin(), pass.uses.end(), [&](const graph_use &u){ return u.resource == pass.barrier_resources[i]; });
+            if (use == pass.uses.end() || barrier.newLayout != describe_access(use->access).layout)
+            {
+                std::println("{} leaves {} in {} instead of the layout the pass uses", pass.name, resource.name, vk::to_string(barrier.newLayout));
+                correct = false;
+            }
+            if (!resource.transient || resource.first_use != position)
+                continue;
+            // A transient starts out with garbage, and when it reuses memory it has to wait for whoever had it before
+            if (barrier.oldLayout != vk::ImageLayout::eUndefined)
+            {
+                std::println("{} keeps the contents of {} from {}", pass.name, resource.name, vk::to_string(barrier.oldLayout));
+                correct = false;
+            }
+            if (!resource.aliases.empty() && barrier.srcStageMask == vk::PipelineStageFlags2())
+            {
+                std::println("{} reuses the memory of {} without waiting on its earlier users", resource.name, graph.resources[resource.aliases.front()].name);
+                correct = false;
+            }
+        }
+    }
+    if (graph.final_image_barriers.size() != 1 || graph.final_image_barriers[0].newLayout != vk::ImageLayout::ePresentSrcKHR)
+    {
+        std::println("Expected one barrier after the graph moving the swapchain to present");
+        correct = false;
+    }
+    return correct;
+}
+
+bool run_graph_benchmark()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    frame_graph graph;
+    build_synthetic_graph(graph);
+    compile_graph(graph, estimate_requirements);
+    print_graph(graph);
+
+    bool correct = true;
+    for (const graph_pass &pass : graph.passes)
+    {
+        if (pass.culled != (pass.name == "debug view"))
+        {
+            std::println("Pass {} was {}culled", pass.name, pass.culled ? "" : "not ");
+            correct = false;
+        }
+    }
+    // Transients sharing memory must never be alive at the same time
+    for (size_t a = 0; a < graph.resources.size(); a++)
+    {
+        const graph_resource &x = graph.resources[a];
+        if (!x.transient || x.last_use == std::numeric_limits<uint32_t>::max())
+            continue;
+        if (x.offset % x.requirements.alignment != 0)
+        {
+            std::println("{} is misaligned", x.name);
+            correct = false;
+        }
+        for (size_t b = a + 1; b < graph.resources.size(); b++)
+        {
+            const graph_resource &y = graph.resources[b];
+            if (!y.transient || y.last_use == std::numeric_limits<uint32_t>::max() || x.heap != y.heap)
+                continue;
+            bool memory_overlaps = x.offset < y.offset + y.requirements.size && y.offset < x.offset + x.requirements.size;
+            bool alive_together = x.first_use <= y.last_use && y.first_use <= x.last_use;
+            if (memory_overlaps && alive_together)
+            {
+                std::println("{} and {} share memory while both are alive", x.name, y.name);
+                correct = false;
+            }
+        }
+    }
+    if (graph.heap_bytes >= graph.transient_bytes)
+    {
+        std::println("Aliasing saved nothing, {} bytes aliased against {} on their own", graph.heap_bytes, graph.transient_bytes);
+        correct = false;
+    }
+    if (graph.barriers > graph.naive_barriers)
+    {
+        std::println("{} barriers is more than one per use ({})", graph.barriers, graph.naive_barriers);
+        correct = false;
+    }
+    if (!check_graph_barriers(graph))
+        correct = false;
+
+    // The whole thing is rebuilt every frame, so building and compiling is the per frame cost
+    const int iterations = 1000;
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        build_synthetic_graph(graph);
+        compile_graph(graph, estimate_requirements);
+        samples.push_back(ms(std::chrono::steady_clock::now() - start).count());
+    }
+    double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    std::println("Build and compile: avg {:.4f} ms, p99 {:.4f} ms", avg, percentile(samples, 99.0));
+    std::println(correct ? "Frame graph culling, aliasing and barriers are valid" : "Frame graph check FAILED");
+    return correct;
+}
+
+void run_record_benchmark(const vk::Device &device, uint32_t queue_family, const vk::CommandBufferInheritanceInfo &inheritance,
+                        const record_function &record, uint32_t draw_count)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    constexpr int warmup = 5;
+    constexpr int iterations = 100;
+    uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    std::println("Recording {} draws into secondary command buffers, {} iterations each (ms)", draw_count, iterations);
+    std::println("{:>8} {:>9} {:>9} {:>9} {:>8}", "threads", "avg", "p50", "p95", "speedup");
+    double single_thread = 0.0;
+    for (uint32_t threads: thread_counts)
+    {
+        command_recorder recorder;
+        init_command_recorder(recorder, device, queue_family, threads, 1);
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (int i = 0; i < warmup + iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            record_secondaries(recorder, 0, inheritance, draw_count, record);
+            auto end = std::chrono::steady_clock::now();
+            if (i >= warmup)
+                samples.push_back(ms(end - start).count());
+        }
+        destroy_command_recorder(recorder);
+
+        double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        if (threads == 1)
+            single_thread = avg;
+        std::println("{:>8} {:>9.3f} {:>9.3f} {:>9.3f} {:>7.2f}x", threads, avg, percentile(samples, 50.0), percentile(samples, 95.0), single_thread / avg);
+    }
+}
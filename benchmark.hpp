@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "recorder.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Per frame timings collected by the headless benchmark, all in milliseconds
+struct frame_stats
+{
+    std::vector<double> cpu_record;
+    std::vector<double> submit_to_fence;
+    std::vector<double> frame_time;
+    std::vector<uint64_t> bytes_streamed;
+    uint32_t frames_in_flight = 1;
+
+    void reserve(size_t frames);
+    void add_frame(double cpu_record_ms, double submit_to_fence_ms, double frame_ms, uint64_t streamed = 0);
+    void report() const;
+};
+
+double percentile(std::vector<double> samples, double p);
+
+// CPU only, times integrate_entities against the scalar path at 1k/100k/1M entities, false if they diverge
+bool run_physics_benchmark();
+
+// CPU only, times the grid and sweep and prune broad phases on moving boxes and checks
+// their pairs against brute force where thats affordable. Returns false on a mismatch
+bool run_broadphase_benchmark();
+
+// CPU only, spawns thousands of pooled entities per frame through a wave scheduler while despawning the
+// ones that leave, checks that the pool never reallocates and that every handle still finds its entity
+bool run_spawn_benchmark();
+
+// CPU only, packs random sprites into atlas pages, checks that no two overlap or leave their page
+// and prints pages used and occupancy. Returns false if the packing is broken
+bool run_atlas_benchmark();
+
+// CPU only, runs the memory arena on a fake memory properties table and checks memory type choice, alignment,
+// linear reset and that defragment moves carry every allocation's bytes. Returns false if any of it is wrong
+bool run_arena_benchmark();
+
+// CPU only, compiles a deferred style frame graph with estimated memory requirements and prints its passes,
+// barriers and transient memory with and without aliasing. Returns false if culling or aliasing is wrong
+bool run_graph_benchmark();
+
+// Records draw_count draws through a command recorder with 1, 2, 4... threads up to the core count
+// and prints the CPU record time for each
+void run_record_benchmark(const vk::Device &device, uint32_t queue_family, const vk::CommandBufferInheritanceInfo &inheritance,
+                        const record_function &record, uint32_t draw_count);
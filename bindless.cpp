@@ -0,0 +1,163 @@
+#include "bindless.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+static constexpr std::array<vk::DescriptorType, (size_t)bindless_kind::count> bindless_types = {
+    vk::DescriptorType::eStorageBuffer,
+    vk::DescriptorType::eSampledImage,
+    vk::DescriptorType::eSampler,
+};
+
+// Left of the per stage resource limit for the frame set and the color attachments
+static constexpr uint32_t bindless_reserved_resources = 16;
+
+static uint32_t allocate_slot(bindless_heap &heap, bindless_kind kind)
+{
+    size_t k = (size_t)kind;
+    if (!heap.free_slots[k].empty())
+    {
+        uint32_t slot = heap.free_slots[k].back();
+        heap.free_slots[k].pop_back();
+        return slot;
+    }
+    if (heap.used[k] == heap.capacity[k])
+        throw std::runtime_error("Bindless heap is out of " + vk::to_string(bindless_types[k]) + " slots");
+    return heap.used[k]++;
+}
+
+static void write_slot(bindless_heap &heap, bindless_kind kind, uint32_t slot, const vk::DescriptorBufferInfo *buffer_info,
+                        const vk::DescriptorImageInfo *image_info)
+{
+    vk::WriteDescriptorSet write = {};
+    write.dstSet = heap.set;
+    write.dstBinding = (uint32_t)kind;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = bindless_types[(size_t)kind];
+    write.pBufferInfo = buffer_info;
+    write.pImageInfo = image_info;
+    heap.device.updateDescriptorSets(write, nullptr);
+    heap.writes++;
+}
+
+bindless_heap create_bindless_heap(const vk::Device &device, vk::PhysicalDevice selected_physical_device, uint32_t frames_in_flight,
+                                    uint32_t storage_buffers, uint32_t sampled_images, uint32_t samplers)
+{
+    bindless_heap heap{};
+    heap.device = device;
+    heap.pending_frees.resize(frames_in_flight);
+
+    // Every binding is visible to every graphics stage, so the per stage limits are the ones that bite
+    auto properties = selected_physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const vk::PhysicalDeviceVulkan12Properties &limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+    heap.capacity[(size_t)bindless_kind::storage_buffer] = std::min({storage_buffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                                                    limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+    heap.capacity[(size_t)bindless_kind::sampled_image] = std::min({sampled_images, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                                    limits.maxDescriptorSetUpdateAfterBindSampledImages});
+    heap.capacity[(size_t)bindless_kind::sampler] = std::min({samplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                            limits.maxDescriptorSetUpdateAfterBindSamplers});
+    // Samplers dont count towards the per stage resources, buffers and images do
+    uint64_t budget = std::max(limits.maxPerStageUpdateAfterBindResources, bindless_reserved_resources) - bindless_reserved_resources;
+    uint64_t buffers = heap.capacity[(size_t)bindless_kind::storage_buffer];
+    uint64_t images = heap.capacity[(size_t)bindless_kind::sampled_image];
+    if (buffers + images > budget)
+    {
+        heap.capacity[(size_t)bindless_kind::storage_buffer] = buffers * budget / (buffers + images);
+        heap.capacity[(size_t)bindless_kind::sampled_image] = budget - heap.capacity[(size_t)bindless_kind::storage_buffer];
+    }
+
+    std::array<vk::DescriptorSetLayoutBinding, (size_t)bindless_kind::count> bindings;
+    std::array<vk::DescriptorBindingFlags, (size_t)bindless_kind::count> binding_flags;
+    std::array<vk::DescriptorPoolSize, (size_t)bindless_kind::count> pool_sizes;
+    for (size_t k = 0; k < bindings.size(); k++)
+    {
+        bindings[k].binding = k;
+        bindings[k].descriptorType = bindless_types[k];
+        bindings[k].descriptorCount = heap.capacity[k];
+        bindings[k].stageFlags = vk::ShaderStageFlagBits::eAllGraphics;
+        // Most slots are empty most of the time, and the set is written while earlier frames still use it
+        binding_flags[k] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind
+                            | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        pool_sizes[k] = vk::DescriptorPoolSize(bindless_types[k], heap.capacity[k]);
+    }
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info(binding_flags.size(), binding_flags.data());
+    vk::DescriptorSetLayoutCreateInfo layout_info(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings.size(), bindings.data());
+    layout_info.pNext = &binding_flags_info;
+    heap.layout = device.createDescriptorSetLayout(layout_info);
+
+    vk::DescriptorPoolCreateInfo pool_info(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, pool_sizes.size(), pool_sizes.data());
+    heap.pool = device.createDescriptorPool(pool_info);
+    vk::DescriptorSetAllocateInfo allocate_info(heap.pool, 1, &heap.layout);
+    heap.set = device.allocateDescriptorSets(allocate_info)[0];
+    return heap;
+}
+
+uint32_t bindless_add_buffer(bindless_heap &heap, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    uint32_t slot = allocate_slot(heap, bindless_kind::storage_buffer);
+    bindless_write_buffer(heap, slot, buffer, offset, range);
+    return slot;
+}
+
+uint32_t bindless_add_image(bindless_heap &heap, vk::ImageView view, vk::ImageLayout layout)
+{
+    uint32_t slot = allocate_slot(heap, bindless_kind::sampled_image);
+    vk::DescriptorImageInfo image_info(nullptr, view, layout);
+    write_slot(heap, bindless_kind::sampled_image, slot, nullptr, &image_info);
+    return slot;
+}
+
+uint32_t bindless_add_sampler(bindless_heap &heap, vk::Sampler sampler)
+{
+    uint32_t slot = allocate_slot(heap, bindless_kind::sampler);
+    vk::DescriptorImageInfo image_info(sampler, nullptr, vk::ImageLayout::eUndefined);
+    write_slot(heap, bindless_kind::sampler, slot, nullptr, &image_info);
+    return slot;
+}
+
+void bindless_write_buffer(bindless_heap &heap, uint32_t slot, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    vk::DescriptorBufferInfo buffer_info(buffer, offset, range);
+    write_slot(heap, bindless_kind::storage_buffer, slot, &buffer_info, nullptr);
+}
+
+void bindless_free(bindless_heap &heap, bindless_kind kind, uint32_t slot, uint32_t frame)
+{
+    heap.pending_frees[frame][(size_t)kind].push_back(slot);
+}
+
+void bindless_retire_frees(bindless_heap &heap, uint32_t frame)
+{
+    // Every other frame's fence has been waited on since this one was recorded, so nothing reads these anymore
+    for (size_t k = 0; k < heap.free_slots.size(); k++)
+    {
+        std::vector<uint32_t> &pending = heap.pending_frees[frame][k];
+        heap.free_slots[k].insert(heap.free_slots[k].end(), pending.begin(), pending.end());
+        pending.clear();
+    }
+}
+
+vk::PipelineLayout create_bindless_pipeline_layout(const bindless_heap &heap, vk::DescriptorSetLayout frame_layout)
+{
+    std::array<vk::DescriptorSetLayout, 2> set_layouts = {frame_layout, heap.layout};
+    vk::PushConstantRange push_range(vk::ShaderStageFlagBits::eAllGraphics, 0, sizeof(draw_constants));
+    vk::PipelineLayoutCreateInfo layout_info = {};
+    layout_info.setLayoutCount = set_layouts.size();
+    layout_info.pSetLayouts = set_layouts.data();
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_range;
+    return heap.device.createPipelineLayout(layout_info);
+}
+
+uint32_t bindless_slots_in_use(const bindless_heap &heap, bindless_kind kind)
+{
+    return heap.used[(size_t)kind] - heap.free_slots[(size_t)kind].size();
+}
+
+void destroy_bindless_heap(bindless_heap &heap)
+{
+    // Destroying the pool frees the set
+    heap.device.destroyDescriptorPool(heap.pool);
+    heap.device.destroyDescriptorSetLayout(heap.layout);
+    heap = bindless_heap{};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <vector>
+
+// One big descriptor set with every storage buffer, sampled image and sampler the renderer uses, bound once per
+// command buffer and indexed by slot from the shaders. The arrays are partially bound and update after bind, so
+// adding or replacing something is a single descriptor write and nothing ever gets rebound. A slot must not be
+// rewritten while a frame in flight still reads it, slots no pending frame uses can change any time. Freed slots
+// are only handed out again once the frame that freed them has finished, see bindless_retire_frees
+enum class bindless_kind
+{
+    storage_buffer,
+    sampled_image,
+    sampler,
+    count
+};
+
+// Graphics pipelines take the heap as this set, the shaders declare it as
+//   layout(set = 1, binding = 0) buffer ... []     storage buffers
+//   layout(set = 1, binding = 1) uniform texture2D []
+//   layout(set = 1, binding = 2) uniform sampler []
+constexpr uint32_t bindless_set = 1;
+
+// Push constants of every graphics pipeline, all of them share one layout so the sets stay bound across pipelines
+struct draw_constants
+{
+    uint32_t instances; // storage buffer slot vertex.vert reads instances from
+    uint32_t sampler;   // sampler slot sprite.frag samples with
+};
+
+struct bindless_heap
+{
+    vk::Device device;
+    vk::DescriptorSetLayout layout;
+    vk::DescriptorPool pool;
+    vk::DescriptorSet set;
+    std::array<uint32_t, (size_t)bindless_kind::count> capacity;
+    std::array<uint32_t, (size_t)bindless_kind::count> used;        // slots ever handed out, everything above is untouched
+    std::array<std::vector<uint32_t>, (size_t)bindless_kind::count> free_slots;
+    // [frame][kind], slots freed while recording that frame, they move to free_slots once its fence passed
+    std::vector<std::array<std::vector<uint32_t>, (size_t)bindless_kind::count>> pending_frees;
+    uint64_t writes;
+};
+
+// Asks for this many slots of each kind, less if the device cant have that many update after bind descriptors.
+// Buffers and images also share the per stage resource limit, if together they go over it both shrink evenly
+bindless_heap create_bindless_heap(const vk::Device &device, vk::PhysicalDevice selected_physical_device, uint32_t frames_in_flight,
+                                    uint32_t storage_buffers, uint32_t sampled_images, uint32_t samplers);
+// Each add returns the slot the shaders index with, throws when that kind is full
+uint32_t bindless_add_buffer(bindless_heap &heap, vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+uint32_t bindless_add_image(bindless_heap &heap, vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+uint32_t bindless_add_sampler(bindless_heap &heap, vk::Sampler sampler);
+// Points an existing slot at another buffer, e.g. after it was grown
+void bindless_write_buffer(bindless_heap &heap, uint32_t slot, vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+// frame is the frame in flight being recorded. Frames still in flight can read the slot, so it only goes back
+// to the free list once that frame's fence passed. Its descriptor stays as it is until the slot is handed out again
+void bindless_free(bindless_heap &heap, bindless_kind kind, uint32_t slot, uint32_t frame);
+// Call once frame's fence has been waited on, makes the slots freed while recording it the last time reusable
+void bindless_retire_frees(bindless_heap &heap, uint32_t frame);
+// Set 0 is frame_layout, set bindless_set the heap, plus draw_constants for every graphics stage
+vk::PipelineLayout create_bindless_pipeline_layout(const bindless_heap &heap, vk::DescriptorSetLayout frame_layout);
+uint32_t bindless_slots_in_use(const bindless_heap &heap, bindless_kind kind);
+void destroy_bindless_heap(bindless_heap &heap);
@@ -0,0 +1,128 @@
+#include "broadphase.hpp"
+#include <algorithm>
+#include <cmath>
+
+bool boxes_overlap(const entity_store &store, uint32_t a, uint32_t b)
+{
+    bool collision_x = store.x[a] + store.width[a] / 2 >= store.x[b] - store.width[b] / 2 && store.x[a] - store.width[a] / 2 <= store.x[b] + store.width[b] / 2;
+    bool collision_y = store.y[a] + store.height[a] / 2 >= store.y[b] - store.height[b] / 2 && store.y[a] - store.height[a] / 2 <= store.y[b] + store.height[b] / 2;
+    return collision_x && collision_y;
+}
+
+void find_pairs_brute_force(const entity_store &store, std::vector<collision_pair> &pairs)
+{
+    pairs.clear();
+    for (uint32_t a = 0; a < store.size(); a++)
+    {
+        for (uint32_t b = a + 1; b < store.size(); b++)
+        {
+            if (boxes_overlap(store, a, b))
+                pairs.push_back({a, b});
+        }
+    }
+}
+
+static uint32_t hash_cell(int32_t x, int32_t y, uint32_t mask)
+{
+    return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u)) & mask;
+}
+
+static void find_pairs_grid(broadphase &bp, const entity_store &store)
+{
+    size_t count = store.size();
+    float cell_size = bp.cell_size;
+    if (cell_size <= 0.0f)
+    {
+        double total = 0.0;
+        for (size_t i = 0; i < count; i++)
+            total += std::max(store.width[i], store.height[i]);
+        cell_size = std::max((float)(2.0 * total / count), 1e-4f);
+    }
+    float inv_cell = 1.0f / cell_size;
+
+    // Every box goes into each cell it touches
+    bp.entries.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t min_x = (int32_t)std::floor((store.x[i] - store.width[i] / 2) * inv_cell);
+        int32_t max_x = (int32_t)std::floor((store.x[i] + store.width[i] / 2) * inv_cell);
+        int32_t min_y = (int32_t)std::floor((store.y[i] - store.height[i] / 2) * inv_cell);
+        int32_t max_y = (int32_t)std::floor((store.y[i] + store.height[i] / 2) * inv_cell);
+        for (int32_t cy = min_y; cy <= max_y; cy++)
+        {
+            for (int32_t cx = min_x; cx <= max_x; cx++)
+                bp.entries.push_back({cx, cy, i});
+        }
+    }
+
+    // Counting sort of the entries into hash buckets
+    uint32_t bucket_count = 1;
+    while (bucket_count < bp.entries.size() * 2)
+        bucket_count <<= 1;
+    uint32_t mask = bucket_count - 1;
+    bp.bucket_start.assign(bucket_count + 1, 0);
+    for (auto &entry: bp.entries)
+        bp.bucket_start[hash_cell(entry.cell_x, entry.cell_y, mask) + 1]++;
+    for (uint32_t b = 0; b < bucket_count; b++)
+        bp.bucket_start[b + 1] += bp.bucket_start[b];
+    bp.sorted_entries.resize(bp.entries.size());
+    bp.order.assign(bp.bucket_start.begin(), bp.bucket_start.end() - 1);
+    for (auto &entry: bp.entries)
+        bp.sorted_entries[bp.order[hash_cell(entry.cell_x, entry.cell_y, mask)]++] = entry;
+
+    for (uint32_t b = 0; b < bucket_count; b++)
+    {
+        for (uint32_t i = bp.bucket_start[b]; i < bp.bucket_start[b + 1]; i++)
+        {
+            const broadphase::grid_entry &first = bp.sorted_entries[i];
+            for (uint32_t j = i + 1; j < bp.bucket_start[b + 1]; j++)
+            {
+                const broadphase::grid_entry &second = bp.sorted_entries[j];
+                // Different cells can land in the same bucket
+                if (first.cell_x != second.cell_x || first.cell_y != second.cell_y)
+                    continue;
+                if (!boxes_overlap(store, first.id, second.id))
+                    continue;
+                // Boxes that share several cells only report the pair from the lowest cell they share
+                int32_t shared_x = (int32_t)std::floor(std::max(store.x[first.id] - store.width[first.id] / 2, store.x[second.id] - store.width[second.id] / 2) * inv_cell);
+                int32_t shared_y = (int32_t)std::floor(std::max(store.y[first.id] - store.height[first.id] / 2, store.y[second.id] - store.height[second.id] / 2) * inv_cell);
+                if (shared_x != first.cell_x || shared_y != first.cell_y)
+                    continue;
+                bp.pairs.push_back({std::min(first.id, second.id), std::max(first.id, second.id)});
+            }
+        }
+    }
+}
+
+static void find_pairs_sweep(broadphase &bp, const entity_store &store)
+{
+    size_t count = store.size();
+    bp.sweep.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        bp.sweep[i] = {store.x[i] - store.width[i] / 2, store.x[i] + store.width[i] / 2, i};
+    std::sort(bp.sweep.begin(), bp.sweep.end(), [](const broadphase::sweep_entry &a, const broadphase::sweep_entry &b) {
+        return a.min_x < b.min_x;
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const broadphase::sweep_entry &a = bp.sweep[i];
+        for (size_t j = i + 1; j < count && bp.sweep[j].min_x <= a.max_x; j++)
+        {
+            uint32_t b = bp.sweep[j].id;
+            if (boxes_overlap(store, a.id, b))
+                bp.pairs.push_back({std::min(a.id, b), std::max(a.id, b)});
+        }
+    }
+}
+
+void find_pairs(broadphase &bp, const entity_store &store)
+{
+    bp.pairs.clear();
+    if (store.size() < 2)
+        return;
+    if (bp.method == broadphase_method::grid)
+        find_pairs_grid(bp, store);
+    else
+        find_pairs_sweep(bp, store);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "entities.hpp"
+
+// a < b, both are indices into the entity store the pairs were built from
+struct collision_pair
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+enum class broadphase_method
+{
+    grid,           // uniform spatial hash, good when boxes are about the same size
+    sweep_and_prune // sort on x and sweep, no tuning needed but slows down when many boxes share an x range
+};
+
+// Finds every pair of overlapping boxes (touching counts, same as the narrow phase).
+// The scratch vectors are kept between calls so a steady state step doesnt allocate
+struct broadphase
+{
+    broadphase_method method = broadphase_method::grid;
+    float cell_size = 0.0f; // 0 picks twice the average box size every step
+    std::vector<collision_pair> pairs;
+
+    struct grid_entry
+    {
+        int32_t cell_x;
+        int32_t cell_y;
+        uint32_t id;
+    };
+    std::vector<grid_entry> entries;
+    std::vector<grid_entry> sorted_entries;
+    std::vector<uint32_t> bucket_start;
+    std::vector<uint32_t> order;
+
+    struct sweep_entry
+    {
+        float min_x;
+        float max_x;
+        uint32_t id;
+    };
+    std::vector<sweep_entry> sweep;
+};
+
+void find_pairs(broadphase &bp, const entity_store &store);
+void find_pairs_brute_force(const entity_store &store, std::vector<collision_pair> &pairs);
+bool boxes_overlap(const entity_store &store, uint32_t a, uint32_t b);
@@ -0,0 +1,194 @@
+#include "culling.hpp"
+#include "memory.hpp"
+#include <array>
+#include <algorithm>
+
+static_assert(sizeof(affine_instance) == 9 * sizeof(float), "cull.comp reads affine instances as 9 packed floats");
+static_assert(sizeof(matrix_instance) == 19 * sizeof(float), "cull.comp reads matrix instances as 19 packed floats");
+
+namespace
+{
+    struct cull_constants
+    {
+        glm::vec2 view_min;
+        glm::vec2 view_max;
+        uint32_t first_float;
+        uint32_t count;
+        uint32_t phase;
+        uint32_t draw_count;
+    };
+
+    // Has to match group_size in cull.comp
+    constexpr uint32_t cull_group_size = 256;
+
+    uint32_t cull_group_count(uint32_t instance_count)
+    {
+        return (instance_count + cull_group_size - 1) / cull_group_size;
+    }
+}
+
+cull_pass create_cull_pass(const vk::Device &device, pipeline_cache &pipelines, shader_registry &shaders, uint32_t frames_in_flight, transform_format format)
+{
+    cull_pass pass{};
+    pass.device = device;
+    pass.format = format;
+    pass.instance_stride = instance_stride(format);
+
+    std::array<vk::DescriptorSetLayoutBinding, 4> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        bindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+    vk::DescriptorSetLayoutCreateInfo descriptor_layout_info(vk::DescriptorSetLayoutCreateFlags(), bindings.size(), bindings.data());
+    pass.descriptor_layout = device.createDescriptorSetLayout(descriptor_layout_info);
+
+    vk::DescriptorPoolSize pool_size(vk::DescriptorType::eStorageBuffer, bindings.size() * frames_in_flight);
+    vk::DescriptorPoolCreateInfo pool_info;
+    pool_info.maxSets = frames_in_flight;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    pass.descriptor_pool = device.createDescriptorPool(pool_info);
+
+    vk::PushConstantRange push_range(vk::ShaderStageFlagBits::eCompute, 0, sizeof(cull_constants));
+    vk::PipelineLayoutCreateInfo layout_info = {};
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &pass.descriptor_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_range;
+    pass.pipeline_layout = device.createPipelineLayout(layout_info);
+
+    // Same specialization constant as vertex.vert, picks the instance layout
+    vk::Bool32 full_transform = format == transform_format::matrix;
+    vk::SpecializationMapEntry specialization_entry(0, 0, sizeof(vk::Bool32));
+    vk::SpecializationInfo specialization_info(1, &specialization_entry, sizeof(vk::Bool32), &full_transform);
+
+    vk::ComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipeline_info.stage.module = get_shader_module(shaders, shader_id::cull);
+    pipeline_info.stage.pName = "main";
+    pipeline_info.stage.pSpecializationInfo = &specialization_info;
+    pipeline_info.layout = pass.pipeline_layout;
+    pass.pipeline = create_cached_compute_pipeline(pipelines, pipeline_info);
+    return pass;
+}
+
+static void create_culled_buffer(const vk::Device &device, memory_arena &arena, cull_frame &frame, vk::DeviceSize capacity)
+{
+    // Only the GPU touches it, so it can live in plain device local memory
+    auto culled = create_arena_buffer(device, arena, vk::BufferUsageFlagBits::eStorageBuffer, capacity,
+                                        {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    frame.culled_allocation = culled.first;
+    frame.culled_buffer = culled.second;
+    frame.culled_capacity = capacity;
+}
+
+cull_frame create_cull_frame(const vk::Device &device, cull_pass &pass, memory_arena &arena, uint32_t draw_count)
+{
+    cull_frame frame{};
+    frame.draw_count = std::max(draw_count, 1u);
+    vk::DescriptorSetAllocateInfo allocate_info;
+    allocate_info.descriptorPool = pass.descriptor_pool;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &pass.descriptor_layout;
+    frame.descriptor_set = device.allocateDescriptorSets(allocate_info)[0];
+
+    create_culled_buffer(device, arena, frame, pass.instance_stride * 1024);
+
+    // The CPU resets the commands every frame before the dispatches fill in their instances
+    auto indirect = create_arena_buffer(device, arena, vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                                        sizeof(vk::DrawIndexedIndirectCommand) * frame.draw_count);
+    frame.indirect_allocation = indirect.first;
+    frame.indirect_buffer = indirect.second;
+    frame.indirect = (vk::DrawIndexedIndirectCommand *)frame.indirect_allocation.mapped;
+    std::fill_n(frame.indirect, frame.draw_count, vk::DrawIndexedIndirectCommand(0, 0, 0, 0, 0));
+    return frame;
+}
+
+void prepare_cull(cull_pass &pass, cull_frame &frame, memory_arena &arena, uint32_t instance_count, uint32_t index_count)
+{
+    vk::DeviceSize needed = (vk::DeviceSize)pass.instance_stride * std::max(instance_count, 1u);
+    if (needed > frame.culled_capacity)
+    {
+        vk::DeviceSize capacity = frame.culled_capacity * 2;
+        while (capacity < needed)
+            capacity *= 2;
+        pass.device.destroyBuffer(frame.culled_buffer);
+        arena_free(arena, frame.culled_allocation);
+        create_culled_buffer(pass.device, arena, frame, capacity);
+    }
+    std::fill_n(frame.indirect, frame.draw_count, vk::DrawIndexedIndirectCommand(index_count, 0, 0, 0, 0));
+}
+
+vk::DeviceSize cull_group_buffer_size(uint32_t instance_count)
+{
+    return (vk::DeviceSize)std::max(cull_group_count(instance_count), 1u) * sizeof(uint32_t);
+}
+
+void record_cull(vk::CommandBuffer command_buffer, cull_pass &pass, cull_frame &frame, const stream_buffer &instances,
+                vk::DeviceSize instance_offset, uint32_t instance_count, vk::Buffer group_offsets, glm::vec2 view_min, glm::vec2 view_max)
+{
+    // The stream buffer can be reallocated between frames so the set is rewritten every time
+    std::array<vk::DescriptorBufferInfo, 4> buffer_infos = {
+        vk::DescriptorBufferInfo(instances.buffer, 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(frame.culled_buffer, 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(frame.indirect_buffer, 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(group_offsets, 0, VK_WHOLE_SIZE),
+    };
+    std::array<vk::WriteDescriptorSet, 4> writes;
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].dstSet = frame.descriptor_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    pass.device.updateDescriptorSets(writes, nullptr);
+
+    // Stream offsets are only 4 byte aligned, below the storage buffer offset alignment, so the shader offsets itself
+    cull_constants constants = {view_min, view_max, (uint32_t)(instance_offset / sizeof(float)), instance_count, 0, frame.draw_count};
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pass.pipeline);
+    command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pass.pipeline_layout, 0, frame.descriptor_set, nullptr);
+
+    // An atomic append would hand out slots in whatever order the groups finish, which reorders
+    // overlapping quads every frame and makes them flicker. Counting per group, scanning the counts
+    // and then writing keeps the input order for the cost of two more small dispatches
+    uint32_t groups = cull_group_count(instance_count);
+    vk::MemoryBarrier between_phases(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    for (uint32_t phase = 0; phase < 3; phase++)
+    {
+        if (phase > 0)
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                           vk::DependencyFlags(), between_phases, nullptr, nullptr);
+        constants.phase = phase;
+        command_buffer.pushConstants(pass.pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+        command_buffer.dispatch(phase == 1 ? 1 : groups, 1, 1);
+    }
+}
+
+uint32_t culled_instance_count(const cull_frame &frame)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < frame.draw_count; i++)
+        count += frame.indirect[i].instanceCount;
+    return count;
+}
+
+void destroy_cull_frame(const vk::Device &device, memory_arena &arena, cull_frame &frame)
+{
+    device.destroyBuffer(frame.culled_buffer);
+    arena_free(arena, frame.culled_allocation);
+    device.destroyBuffer(frame.indirect_buffer);
+    arena_free(arena, frame.indirect_allocation);
+}
+
+void destroy_cull_pass(cull_pass &pass)
+{
+    pass.device.destroyPipeline(pass.pipeline);
+    pass.device.destroyPipelineLayout(pass.pipeline_layout);
+    pass.device.destroyDescriptorPool(pass.descriptor_pool);
+    pass.device.destroyDescriptorSetLayout(pass.descriptor_layout);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "arena.hpp"
+#include "stream.hpp"
+#include "pipeline_cache.hpp"
+#include "shaders.hpp"
+#include "mesh.hpp"
+
+// Compute pass that drops instances outside the view and compacts the rest, in their original order,
+// into a buffer the draw reads through drawIndexedIndirect, the CPU never looks at what is visible
+struct cull_pass
+{
+    vk::Device device;
+    vk::DescriptorSetLayout descriptor_layout;
+    vk::DescriptorPool descriptor_pool;
+    vk::PipelineLayout pipeline_layout;
+    vk::Pipeline pipeline;
+    transform_format format;
+    uint32_t instance_stride;
+};
+
+// Everything one frame in flight needs, the culled buffer grows like a stream buffer does
+struct cull_frame
+{
+    vk::DescriptorSet descriptor_set;
+    vk::Buffer culled_buffer;
+    arena_allocation culled_allocation;
+    vk::DeviceSize culled_capacity;
+    vk::Buffer indirect_buffer;
+    arena_allocation indirect_allocation;
+    vk::DrawIndexedIndirectCommand *indirect;   // draw_count commands, one per recording slice
+    uint32_t draw_count;
+};
+
+cull_pass create_cull_pass(const vk::Device &device, pipeline_cache &pipelines, shader_registry &shaders, uint32_t frames_in_flight, transform_format format);
+// The survivors are split over draw_count indirect draws so several threads can record them,
+// draw i is at indirect_buffer offset i * sizeof(vk::DrawIndexedIndirectCommand)
+cull_frame create_cull_frame(const vk::Device &device, cull_pass &pass, memory_arena &arena, uint32_t draw_count);
+// Grows the culled buffer if instance_count wont fit and resets the indirect draws.
+// Call once the frame's fence has been waited on, before anything looks at culled_buffer
+void prepare_cull(cull_pass &pass, cull_frame &frame, memory_arena &arena, uint32_t instance_count, uint32_t index_count);
+// Size of the scratch buffer record_cull keeps its per workgroup offsets in, needs storage buffer usage
+vk::DeviceSize cull_group_buffer_size(uint32_t instance_count);
+// view_min and view_max are the visible area in world space. Records only the dispatches and the barriers
+// between them, whoever reads culled_buffer or the indirect draw afterwards has to put a barrier in between.
+// group_offsets is only used inside, it can be a transient. Call outside rendering
+void record_cull(vk::CommandBuffer command_buffer, cull_pass &pass, cull_frame &frame, const stream_buffer &instances,
+                vk::DeviceSize instance_offset, uint32_t instance_count, vk::Buffer group_offsets, glm::vec2 view_min, glm::vec2 view_max);
+// How many instances the last finished use of this frame drew, over all its draws. The submit needs a barrier
+// that makes the cull's writes to indirect_buffer visible to the host, like graph_access::host_read
+uint32_t culled_instance_count(const cull_frame &frame);
+void destroy_cull_frame(const vk::Device &device, memory_arena &arena, cull_frame &frame);
+void destroy_cull_pass(cull_pass &pass);
@@ -0,0 +1,299 @@
+#include "entities.hpp"
+#include <cstdint>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void reserve_entities(entity_store &store, size_t count)
+{
+    store.x.reserve(count);
+    store.y.reserve(count);
+    store.velocity_x.reserve(count);
+    store.velocity_y.reserve(count);
+    store.acc_x.reserve(count);
+    store.acc_y.reserve(count);
+    store.width.reserve(count);
+    store.height.reserve(count);
+    store.color.reserve(count);
+}
+
+size_t add_entity(entity_store &store, const bounding_box &box, glm::vec3 color)
+{
+    store.x.push_back(box.x);
+    store.y.push_back(box.y);
+    store.velocity_x.push_back(box.velocityX);
+    store.velocity_y.push_back(box.velocityY);
+    store.acc_x.push_back(box.accX);
+    store.acc_y.push_back(box.accY);
+    store.width.push_back(box.width);
+    store.height.push_back(box.height);
+    store.color.push_back(color);
+    return store.size() - 1;
+}
+
+template <typename T>
+static void swap_remove(std::vector<T> &column, size_t index)
+{
+    column[index] = column.back();
+    column.pop_back();
+}
+
+void remove_entity(entity_store &store, size_t index)
+{
+    swap_remove(store.x, index);
+    swap_remove(store.y, index);
+    swap_remove(store.velocity_x, index);
+    swap_remove(store.velocity_y, index);
+    swap_remove(store.acc_x, index);
+    swap_remove(store.acc_y, index);
+    swap_remove(store.width, index);
+    swap_remove(store.height, index);
+    swap_remove(store.color, index);
+}
+
+void clear_entities(entity_store &store)
+{
+    store.x.clear();
+    store.y.clear();
+    store.velocity_x.clear();
+    store.velocity_y.clear();
+    store.acc_x.clear();
+    store.acc_y.clear();
+    store.width.clear();
+    store.height.clear();
+    store.color.clear();
+}
+
+static constexpr uint32_t dead_slot = UINT32_MAX;
+
+void init_entity_pool(entity_pool &pool, size_t capacity)
+{
+    clear_entity_pool(pool);
+    reserve_entities(pool.store, capacity + 1);
+    pool.slot_to_dense.reserve(capacity);
+    pool.generations.reserve(capacity);
+    pool.dense_to_slot.reserve(capacity + 1);
+    pool.free_slots.reserve(capacity);
+}
+
+entity_handle spawn_entity(entity_pool &pool, const bounding_box &box, glm::vec3 color)
+{
+    uint32_t slot;
+    if (!pool.free_slots.empty())
+    {
+        slot = pool.free_slots.back();
+        pool.free_slots.pop_back();
+    }
+    else
+    {
+        slot = pool.slot_to_dense.size();
+        pool.slot_to_dense.push_back(dead_slot);
+        pool.generations.push_back(0);
+    }
+    pool.slot_to_dense[slot] = add_entity(pool.store, box, color);
+    pool.dense_to_slot.push_back(slot);
+    return {slot, pool.generations[slot]};
+}
+
+void despawn_entity_at(entity_pool &pool, size_t index)
+{
+    uint32_t slot = pool.dense_to_slot[index];
+    uint32_t moved_slot = pool.dense_to_slot.back();
+    remove_entity(pool.store, index);
+    pool.dense_to_slot[index] = moved_slot;
+    pool.dense_to_slot.pop_back();
+    pool.slot_to_dense[moved_slot] = index;
+
+    pool.slot_to_dense[slot] = dead_slot;
+    pool.generations[slot]++;
+    pool.free_slots.push_back(slot);
+}
+
+bool despawn_entity(entity_pool &pool, entity_handle handle)
+{
+    size_t index = entity_index(pool, handle);
+    if (index == SIZE_MAX)
+        return false;
+    despawn_entity_at(pool, index);
+    return true;
+}
+
+bool entity_alive(const entity_pool &pool, entity_handle handle)
+{
+    return entity_index(pool, handle) != SIZE_MAX;
+}
+
+size_t entity_index(const entity_pool &pool, entity_handle handle)
+{
+    if (handle.slot >= pool.slot_to_dense.size() || pool.generations[handle.slot] != handle.generation || pool.slot_to_dense[handle.slot] == dead_slot)
+        return SIZE_MAX;
+    return pool.slot_to_dense[handle.slot];
+}
+
+entity_handle entity_handle_at(const entity_pool &pool, size_t index)
+{
+    uint32_t slot = pool.dense_to_slot[index];
+    return {slot, pool.generations[slot]};
+}
+
+// Old handles have to go stale, so slots keep their generation and all go back on the free list
+static void release_all_slots(entity_pool &pool)
+{
+    pool.free_slots.clear();
+    for (uint32_t slot = pool.slot_to_dense.size(); slot-- > 0;)
+    {
+        if (pool.slot_to_dense[slot] != dead_slot)
+            pool.generations[slot]++;
+        pool.slot_to_dense[slot] = dead_slot;
+        pool.free_slots.push_back(slot);
+    }
+    pool.dense_to_slot.clear();
+}
+
+void clear_entity_pool(entity_pool &pool)
+{
+    clear_entities(pool.store);
+    release_all_slots(pool);
+}
+
+void adopt_store_entities(entity_pool &pool)
+{
+    release_all_slots(pool);
+    size_t count = pool.store.size();
+    pool.dense_to_slot.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t slot;
+        if (!pool.free_slots.empty())
+        {
+            slot = pool.free_slots.back();
+            pool.free_slots.pop_back();
+        }
+        else
+        {
+            slot = pool.slot_to_dense.size();
+            pool.slot_to_dense.push_back(dead_slot);
+            pool.generations.push_back(0);
+        }
+        pool.slot_to_dense[slot] = i;
+        pool.dense_to_slot[i] = slot;
+    }
+}
+
+bounding_box get_entity_box(const entity_store &store, size_t index)
+{
+    bounding_box box{};
+    box.x = store.x[index];
+    box.y = store.y[index];
+    box.width = store.width[index];
+    box.height = store.height[index];
+    box.velocityX = store.velocity_x[index];
+    box.velocityY = store.velocity_y[index];
+    box.accX = store.acc_x[index];
+    box.accY = store.acc_y[index];
+    return box;
+}
+
+void integrate_entities_scalar(entity_store &store, float t, size_t first)
+{
+    float half_t2 = 0.5f * t * t;
+    size_t count = store.size();
+    float *x = store.x.data();
+    float *y = store.y.data();
+    float *vx = store.velocity_x.data();
+    float *vy = store.velocity_y.data();
+    const float *ax = store.acc_x.data();
+    const float *ay = store.acc_y.data();
+    for (size_t i = first; i < count; i++)
+    {
+        y[i] += vy[i] * t + ay[i] * half_t2;
+        vy[i] += ay[i] * t;
+        x[i] += vx[i] * t + ax[i] * half_t2;
+        vx[i] += ax[i] * t;
+    }
+}
+
+#if defined(__AVX__)
+void integrate_entities(entity_store &store, float t)
+{
+    size_t count = store.size();
+    float *x = store.x.data();
+    float *y = store.y.data();
+    float *vx = store.velocity_x.data();
+    float *vy = store.velocity_y.data();
+    const float *ax = store.acc_x.data();
+    const float *ay = store.acc_y.data();
+    __m256 tv = _mm256_set1_ps(t);
+    __m256 half_t2 = _mm256_set1_ps(0.5f * t * t);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 a = _mm256_loadu_ps(ay + i);
+        __m256 v = _mm256_loadu_ps(vy + i);
+        __m256 p = _mm256_loadu_ps(y + i);
+        p = _mm256_add_ps(p, _mm256_add_ps(_mm256_mul_ps(v, tv), _mm256_mul_ps(a, half_t2)));
+        _mm256_storeu_ps(y + i, p);
+        _mm256_storeu_ps(vy + i, _mm256_add_ps(v, _mm256_mul_ps(a, tv)));
+
+        a = _mm256_loadu_ps(ax + i);
+        v = _mm256_loadu_ps(vx + i);
+        p = _mm256_loadu_ps(x + i);
+        p = _mm256_add_ps(p, _mm256_add_ps(_mm256_mul_ps(v, tv), _mm256_mul_ps(a, half_t2)));
+        _mm256_storeu_ps(x + i, p);
+        _mm256_storeu_ps(vx + i, _mm256_add_ps(v, _mm256_mul_ps(a, tv)));
+    }
+    integrate_entities_scalar(store, t, i);
+}
+
+const char *integrator_name()
+{
+    return "avx";
+}
+#elif defined(__SSE2__)
+void integrate_entities(entity_store &store, float t)
+{
+    size_t count = store.size();
+    float *x = store.x.data();
+    float *y = store.y.data();
+    float *vx = store.velocity_x.data();
+    float *vy = store.velocity_y.data();
+    const float *ax = store.acc_x.data();
+    const float *ay = store.acc_y.data();
+    __m128 tv = _mm_set1_ps(t);
+    __m128 half_t2 = _mm_set1_ps(0.5f * t * t);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(ay + i);
+        __m128 v = _mm_loadu_ps(vy + i);
+        __m128 p = _mm_loadu_ps(y + i);
+        p = _mm_add_ps(p, _mm_add_ps(_mm_mul_ps(v, tv), _mm_mul_ps(a, half_t2)));
+        _mm_storeu_ps(y + i, p);
+        _mm_storeu_ps(vy + i, _mm_add_ps(v, _mm_mul_ps(a, tv)));
+
+        a = _mm_loadu_ps(ax + i);
+        v = _mm_loadu_ps(vx + i);
+        p = _mm_loadu_ps(x + i);
+        p = _mm_add_ps(p, _mm_add_ps(_mm_mul_ps(v, tv), _mm_mul_ps(a, half_t2)));
+        _mm_storeu_ps(x + i, p);
+        _mm_storeu_ps(vx + i, _mm_add_ps(v, _mm_mul_ps(a, tv)));
+    }
+    integrate_entities_scalar(store, t, i);
+}
+
+const char *integrator_name()
+{
+    return "sse2";
+}
+#else
+void integrate_entities(entity_store &store, float t)
+{
+    integrate_entities_scalar(store, t);
+}
+
+const char *integrator_name()
+{
+    return "scalar";
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct bounding_box
+{
+    float x;
+    float y;
+    float width;
+    float height;
+    float velocityX;
+    float velocityY;
+    float accX;
+    float accY;
+};
+
+// Structure of arrays entity storage, every column has one element per entity so the integrator
+// can stream through them with SIMD loads. Removing swaps the last entity into the hole
+struct entity_store
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> acc_x;
+    std::vector<float> acc_y;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<glm::vec3> color;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+};
+
+void reserve_entities(entity_store &store, size_t count);
+size_t add_entity(entity_store &store, const bounding_box &box, glm::vec3 color);
+void remove_entity(entity_store &store, size_t index);
+void clear_entities(entity_store &store);
+bounding_box get_entity_box(const entity_store &store, size_t index);
+
+// Stable reference to an entity in a pool, it survives other entities being removed.
+// The generation tells a reused slot apart from the entity that used to live there
+struct entity_handle
+{
+    uint32_t slot;
+    uint32_t generation;
+};
+
+// Dense entity_store plus a slot table, so handles stay valid while removal keeps swapping the last
+// entity into the hole. Freed slots are reused through a free list, nothing allocates while the pool
+// stays under the capacity it was made with
+struct entity_pool
+{
+    entity_store store;
+    std::vector<uint32_t> slot_to_dense;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> dense_to_slot;
+    std::vector<uint32_t> free_slots;
+};
+
+// Reserves room for capacity entities (plus one, the simulation borrows a spot for the player)
+void init_entity_pool(entity_pool &pool, size_t capacity);
+entity_handle spawn_entity(entity_pool &pool, const bounding_box &box, glm::vec3 color);
+// False if the handle was stale. Like remove_entity the last entity moves into the hole
+bool despawn_entity(entity_pool &pool, entity_handle handle);
+void despawn_entity_at(entity_pool &pool, size_t index);
+bool entity_alive(const entity_pool &pool, entity_handle handle);
+// Where a live entity currently sits in the store, SIZE_MAX if the handle is stale
+size_t entity_index(const entity_pool &pool, entity_handle handle);
+entity_handle entity_handle_at(const entity_pool &pool, size_t index);
+void clear_entity_pool(entity_pool &pool);
+// Hands out a handle to every entity already in the store, for after it was filled in bulk
+void adopt_store_entities(entity_pool &pool);
+
+// p += v*t + a*t*t/2, v += a*t for every entity
+void integrate_entities(entity_store &store, float t);
+void integrate_entities_scalar(entity_store &store, float t, size_t first = 0);
+// "avx", "sse2" or "scalar", whatever integrate_entities was compiled with
+const char *integrator_name();
@@ -0,0 +1,630 @@
+#include "frame_graph.hpp"
+#include "memory.hpp"
+#include <algorithm>
+#include <limits>
+#include <print>
+#include <stdexcept>
+
+using stage = vk::PipelineStageFlagBits2;
+using access = vk::AccessFlagBits2;
+
+static constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+
+graph_access_info describe_access(graph_access use)
+{
+    switch (use)
+    {
+    case graph_access::none:
+        return {stage::eNone, access::eNone, vk::ImageLayout::eUndefined, false};
+    case graph_access::acquired:
+        return {stage::eColorAttachmentOutput, access::eNone, vk::ImageLayout::eUndefined, false};
+    case graph_access::compute_read:
+        return {stage::eComputeShader, access::eShaderStorageRead, vk::ImageLayout::eGeneral, false};
+    case graph_access::compute_write:
+        return {stage::eComputeShader, access::eShaderStorageRead | access::eShaderStorageWrite, vk::ImageLayout::eGeneral, true};
+    case graph_access::vertex_read:
+        return {stage::eVertexShader, access::eShaderStorageRead, vk::ImageLayout::eGeneral, false};
+    case graph_access::vertex_input:
+        return {stage::eVertexAttributeInput | stage::eIndexInput, access::eVertexAttributeRead | access::eIndexRead,
+                vk::ImageLayout::eUndefined, false};
+    case graph_access::indirect_read:
+        return {stage::eDrawIndirect, access::eIndirectCommandRead, vk::ImageLayout::eUndefined, false};
+    case graph_access::fragment_sample:
+        return {stage::eFragmentShader, access::eShaderSampledRead, vk::ImageLayout::eShaderReadOnlyOptimal, false};
+    case graph_access::color_write:
+        return {stage::eColorAttachmentOutput, access::eColorAttachmentWrite, vk::ImageLayout::eColorAttachmentOptimal, true};
+    case graph_access::depth_write:
+        // The depth only layout needs separateDepthStencilLayouts, this one works for every depth format
+        return {stage::eEarlyFragmentTests | stage::eLateFragmentTests, access::eDepthStencilAttachmentRead | access::eDepthStencilAttachmentWrite,
+                vk::ImageLayout::eDepthStencilAttachmentOptimal, true};
+    case graph_access::transfer_read:
+        return {stage::eTransfer, access::eTransferRead, vk::ImageLayout::eTransferSrcOptimal, false};
+    case graph_access::transfer_write:
+        return {stage::eTransfer, access::eTransferWrite, vk::ImageLayout::eTransferDstOptimal, true};
+    case graph_access::host_read:
+        // The fence wait alone doesnt make device writes visible to the host, this does
+        return {stage::eHost, access::eHostRead, vk::ImageLayout::eUndefined, false};
+    case graph_access::present:
+        // The present waits on a semaphore signalled after everything in the submit, only the layout matters
+        return {stage::eNone, access::eNone, vk::ImageLayout::ePresentSrcKHR, false};
+    }
+    throw std::runtime_error("Unknown graph access");
+}
+
+static bool is_depth_format(vk::Format format)
+{
+    return format == vk::Format::eD16Unorm || format == vk::Format::eD32Sfloat || format == vk::Format::eD24UnormS8Uint
+            || format == vk::Format::eD32SfloatS8Uint;
+}
+
+static bool has_stencil(vk::Format format)
+{
+    return format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+}
+
+// Barriers on a depth stencil image have to name both aspects, it only has one layout for both
+static vk::ImageSubresourceRange whole_image(const graph_resource &resource)
+{
+    vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+    if (resource.transient && is_depth_format(resource.format))
+        aspect = has_stencil(resource.format) ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil
+                                              : vk::ImageAspectFlagBits::eDepth;
+    return vk::ImageSubresourceRange(aspect, 0, 1, 0, 1);
+}
+
+// Views only see depth, a view that is sampled cant have both aspects and the depth attachment only needs depth
+static vk::ImageSubresourceRange view_range(const graph_resource &resource)
+{
+    vk::ImageSubresourceRange range = whole_image(resource);
+    if (range.aspectMask & vk::ImageAspectFlagBits::eDepth)
+        range.aspectMask = vk::ImageAspectFlagBits::eDepth;
+    return range;
+}
+
+static vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void begin_graph(frame_graph &graph)
+{
+    graph.resources.clear();
+    graph.passes.clear();
+    graph.order.clear();
+    graph.heaps.clear();
+    graph.final_image_barriers.clear();
+    graph.final_buffer_barriers.clear();
+    graph.final_resources.clear();
+}
+
+static graph_handle add_resource(frame_graph &graph, const std::string &name, bool image, bool transient)
+{
+    graph_resource resource{};
+    resource.name = name;
+    resource.image = image;
+    resource.transient = transient;
+    resource.first_use = unused;
+    resource.last_use = unused;
+    graph.resources.push_back(std::move(resource));
+    return graph.resources.size() - 1;
+}
+
+graph_handle import_image(frame_graph &graph, const std::string &name, vk::Image image, vk::ImageView view, graph_access initial, graph_access final)
+{
+    graph_handle handle = add_resource(graph, name, true, false);
+    graph.resources[handle].vk_image = image;
+    graph.resources[handle].view = view;
+    graph.resources[handle].initial = initial;
+    graph.resources[handle].final = final;
+    return handle;
+}
+
+graph_handle import_buffer(frame_graph &graph, const std::string &name, vk::Buffer buffer, graph_access initial, graph_access final)
+{
+    graph_handle handle = add_resource(graph, name, false, false);
+    graph.resources[handle].buffer = buffer;
+    graph.resources[handle].initial = initial;
+    graph.resources[handle].final = final;
+    return handle;
+}
+
+graph_handle create_graph_image(frame_graph &graph, const std::string &name, vk::Format format, vk::Extent2D extent)
+{
+    graph_handle handle = add_resource(graph, name, true, true);
+    graph.resources[handle].format = format;
+    graph.resources[handle].extent = extent;
+    return handle;
+}
+
+graph_handle create_graph_buffer(frame_graph &graph, const std::string &name, vk::DeviceSize size)
+{
+    graph_handle handle = add_resource(graph, name, false, true);
+    graph.resources[handle].size = size;
+    return handle;
+}
+
+void add_graph_pass(frame_graph &graph, const std::string &name, std::vector<graph_use> uses, std::function<void(vk::CommandBuffer)> record)
+{
+    for (const graph_use &use : uses)
+        if (use.resource >= graph.resources.size())
+            throw std::runtime_error("Pass " + name + " uses a resource that isnt in the graph");
+    graph_pass pass{};
+    pass.name = name;
+    pass.uses = std::move(uses);
+    pass.record = std::move(record);
+    graph.passes.push_back(std::move(pass));
+}
+
+// Walks back from whatever outlives the graph, a pass survives if something needed reads what it writes
+static void cull_passes(frame_graph &graph)
+{
+    std::vector<bool> needed(graph.resources.size());
+    for (size_t r = 0; r < graph.resources.size(); r++)
+        needed[r] = !graph.resources[r].transient && graph.resources[r].final != graph_access::none;
+
+    for (size_t p = graph.passes.size(); p-- > 0;)
+    {
+        graph_pass &pass = graph.passes[p];
+        pass.culled = true;
+        for (const graph_use &use : pass.uses)
+            if (describe_access(use.access).write && needed[use.resource])
+                pass.culled = false;
+        if (pass.culled)
+            continue;
+        for (const graph_use &use : pass.uses)
+            if (!describe_access(use.access).write)
+                needed[use.resource] = true;
+    }
+    for (uint32_t p = 0; p < graph.passes.size(); p++)
+        if (!graph.passes[p].culled)
+            graph.order.push_back(p);
+}
+
+static void place_transients(frame_graph &graph, const graph_requirements_function &requirements)
+{
+    std::vector<graph_handle> transients;
+    for (graph_handle r = 0; r < graph.resources.size(); r++)
+    {
+        graph_resource &resource = graph.resources[r];
+        if (!resource.transient || resource.first_use == unused)
+            continue;
+        resource.requirements = requirements(resource);
+        graph.transient_bytes += resource.requirements.size;
+        transients.push_back(r);
+    }
+
+    // Biggest first packs tighter, stable so the same graph always ends up with the same layout
+    std::stable_sort(transients.begin(), transients.end(), [&](graph_handle a, graph_handle b)
+                     { return graph.resources[a].requirements.size > graph.resources[b].requirements.size; });
+
+    std::vector<graph_handle> placed;
+    std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> taken;
+    for (graph_handle r : transients)
+    {
+        graph_resource &resource = graph.resources[r];
+        uint32_t heap = 0;
+        while (heap < graph.heaps.size() && graph.heaps[heap].memory_type_bits != resource.requirements.memoryTypeBits)
+            heap++;
+        if (heap == graph.heaps.size())
+            graph.heaps.push_back({resource.requirements.memoryTypeBits, 0, graph.alias_granularity});
+
+        // Ranges of everything already in this heap that is alive at the same time
+        taken.clear();
+        for (graph_handle other : placed)
+        {
+            const graph_resource &o = graph.resources[other];
+            if (o.heap == heap && o.first_use <= resource.last_use && resource.first_use <= o.last_use)
+                taken.push_back({o.offset, o.offset + o.requirements.size});
+        }
+        std::sort(taken.begin(), taken.end());
+
+        vk::DeviceSize alignment = std::max(resource.requirements.alignment, graph.alias_granularity);
+        vk::DeviceSize offset = 0;
+        for (const auto &[begin, end] : taken)
+        {
+            if (offset + resource.requirements.size <= begin)
+                break;
+            offset = std::max(offset, align_up(end, alignment));
+        }
+        resource.heap = heap;
+        resource.offset = offset;
+        graph.heaps[heap].size = std::max(graph.heaps[heap].size, offset + resource.requirements.size);
+        graph.heaps[heap].alignment = std::max(graph.heaps[heap].alignment, alignment);
+
+        for (graph_handle other : placed)
+        {
+            const graph_resource &o = graph.resources[other];
+            if (o.heap == heap && o.offset < offset + resource.requirements.size && offset < o.offset + o.requirements.size)
+            {
+                if (o.last_use < resource.first_use)
+                    resource.aliases.push_back(other);
+                else
+                    graph.resources[other].aliases.push_back(r);
+            }
+        }
+        placed.push_back(r);
+    }
+    for (const graph_heap &heap : graph.heaps)
+        graph.heap_bytes += heap.size;
+}
+
+static graph_state initial_state(const frame_graph &graph, const graph_resource &resource)
+{
+    graph_state state{};
+    if (!resource.transient)
+    {
+        graph_access_info info = describe_access(resource.initial);
+        state.write_stage = info.stage;
+        state.write_access = info.access;
+        state.layout = info.layout;
+        return state;
+    }
+    // Whatever used the memory before has to be done with it, the contents are garbage either way
+    for (graph_handle alias : resource.aliases)
+    {
+        const graph_resource &previous = graph.resources[alias];
+        if (previous.last_use >= resource.first_use)
+            continue;
+        state.write_stage |= previous.state.write_stage | previous.state.read_stages;
+        state.write_access |= previous.state.write_access;
+    }
+    state.layout = vk::ImageLayout::eUndefined;
+    return state;
+}
+
+// Moves a resource to info, adding a barrier to the lists if the state it is in isnt good enough
+static bool transition(graph_resource &resource, const graph_access_info &info, std::vector<vk::ImageMemoryBarrier2> &image_barriers,
+                        std::vector<vk::BufferMemoryBarrier2> &buffer_barriers)
+{
+    graph_state &state = resource.state;
+    bool layout_change = resource.image && state.layout != info.layout;
+    vk::PipelineStageFlags2 src_stage;
+    vk::AccessFlags2 src_access;
+    bool barrier;
+    if (info.write)
+    {
+        // Writes wait for the reads before them and for the last write, a read after write is fine without
+        barrier = state.read_stages || state.write_stage || layout_change;
+        src_stage = state.write_stage | state.read_stages;
+        src_access = state.write_access;
+    }
+    else
+    {
+        // Reading the same thing again in a stage that already saw the write needs nothing
+        bool visible = (state.visible_stages & info.stage) == info.stage && (state.visible_access & info.access) == info.access;
+        barrier = (state.write_stage && !visible) || layout_change;
+        src_stage = state.write_stage | (layout_change ? state.read_stages : vk::PipelineStageFlags2());
+        src_access = state.write_access;
+    }
+
+    if (barrier)
+    {
+        if (resource.image)
+            image_barriers.push_back(vk::ImageMemoryBarrier2(src_stage, src_access, info.stage, info.access, state.layout, info.layout,
+                                                            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.vk_image,
+                                                            whole_image(resource)));
+        else
+            buffer_barriers.push_back(vk::BufferMemoryBarrier2(src_stage, src_access, info.stage, info.access, VK_QUEUE_FAMILY_IGNORED,
+                                                                VK_QUEUE_FAMILY_IGNORED, resource.buffer, 0, VK_WHOLE_SIZE));
+    }
+
+    if (info.write)
+    {
+        state.write_stage = info.stage;
+        state.write_access = info.access;
+        state.read_stages = {};
+        state.visible_stages = {};
+        state.visible_access = {};
+    }
+    else
+    {
+        state.read_stages |= info.stage;
+        if (barrier)
+        {
+            // Later readers have to chain behind the transition, not just the write
+            if (layout_change)
+            {
+                state.write_stage |= info.stage;
+                state.visible_stages = {};
+                state.visible_access = {};
+            }
+            state.visible_stages |= info.stage;
+            state.visible_access |= info.access;
+        }
+    }
+    state.layout = info.layout;
+    return barrier;
+}
+
+static void simulate_barriers(frame_graph &graph)
+{
+    // Everything a pass does to one resource turns into one combined access
+    std::vector<std::pair<graph_handle, graph_access_info>> merged;
+    for (size_t position = 0; position < graph.order.size(); position++)
+    {
+        graph_pass &pass = graph.passes[graph.order[position]];
+        merged.clear();
+        for (const graph_use &use : pass.uses)
+        {
+            graph_access_info info = describe_access(use.access);
+            auto it = std::find_if(merged.begin(), merged.end(), [&](const auto &m) { return m.first == use.resource; });
+            if (it == merged.end())
+            {
+                merged.push_back({use.resource, info});
+                continue;
+            }
+            if (graph.resources[use.resource].image && it->second.layout != info.layout)
+                throw std::runtime_error("Pass " + pass.name + " uses " + graph.resources[use.resource].name + " in two layouts");
+            it->second.stage |= info.stage;
+            it->second.access |= info.access;
+            it->second.write |= info.write;
+        }
+
+        for (const auto &[handle, info] : merged)
+        {
+            graph_resource &resource = graph.resources[handle];
+            if (resource.first_use == position)
+                resource.state = initial_state(graph, resource);
+            graph.naive_barriers++;
+
+            size_t images = pass.image_barriers.size();
+            if (transition(resource, info, pass.image_barriers, pass.buffer_barriers))
+                pass.barrier_resources.insert(pass.image_barriers.size() > images ? pass.barrier_resources.begin() + images
+                                                                                  : pass.barrier_resources.end(), handle);
+        }
+        graph.barriers += pass.image_barriers.size() + pass.buffer_barriers.size();
+        graph.barrier_batches += !pass.image_barriers.empty() || !pass.buffer_barriers.empty();
+    }
+
+    for (graph_handle r = 0; r < graph.resources.size(); r++)
+    {
+        graph_resource &resource = graph.resources[r];
+        if (resource.transient || resource.final == graph_access::none)
+            continue;
+        if (resource.first_use == unused)
+            resource.state = initial_state(graph, resource);
+        graph.naive_barriers++;
+        size_t images = graph.final_image_barriers.size();
+        if (transition(resource, describe_access(resource.final), graph.final_image_barriers, graph.final_buffer_barriers))
+            graph.final_resources.insert(graph.final_image_barriers.size() > images ? graph.final_resources.begin() + images
+                                                                                    : graph.final_resources.end(), r);
+    }
+    graph.barriers += graph.final_image_barriers.size() + graph.final_buffer_barriers.size();
+    graph.barrier_batches += !graph.final_image_barriers.empty() || !graph.final_buffer_barriers.empty();
+}
+
+void compile_graph(frame_graph &graph, const graph_requirements_function &requirements)
+{
+    graph.order.clear();
+    graph.heaps.clear();
+    graph.final_image_barriers.clear();
+    graph.final_buffer_barriers.clear();
+    graph.final_resources.clear();
+    graph.barriers = 0;
+    graph.barrier_batches = 0;
+    graph.naive_barriers = 0;
+    graph.transient_bytes = 0;
+    graph.heap_bytes = 0;
+    for (graph_pass &pass : graph.passes)
+    {
+        pass.image_barriers.clear();
+        pass.buffer_barriers.clear();
+        pass.barrier_resources.clear();
+    }
+
+    cull_passes(graph);
+
+    // Lifetimes and, for transients, the usage they need to be created with
+    for (uint32_t position = 0; position < graph.order.size(); position++)
+    {
+        for (const graph_use &use : graph.passes[graph.order[position]].uses)
+        {
+            graph_resource &resource = graph.resources[use.resource];
+            if (resource.first_use == unused)
+                resource.first_use = position;
+            resource.last_use = position;
+            if (!resource.transient)
+                continue;
+            switch (use.access)
+            {
+            case graph_access::compute_read:
+            case graph_access::compute_write:
+            case graph_access::vertex_read:
+                resource.image_usage |= vk::ImageUsageFlagBits::eStorage;
+                resource.buffer_usage |= vk::BufferUsageFlagBits::eStorageBuffer;
+                break;
+            case graph_access::vertex_input:
+                resource.buffer_usage |= vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer;
+                break;
+            case graph_access::indirect_read:
+                resource.buffer_usage |= vk::BufferUsageFlagBits::eIndirectBuffer;
+                break;
+            case graph_access::fragment_sample:
+                resource.image_usage |= vk::ImageUsageFlagBits::eSampled;
+                break;
+            case graph_access::color_write:
+                resource.image_usage |= vk::ImageUsageFlagBits::eColorAttachment;
+                break;
+            case graph_access::depth_write:
+                resource.image_usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+                break;
+            case graph_access::transfer_read:
+                resource.image_usage |= vk::ImageUsageFlagBits::eTransferSrc;
+                resource.buffer_usage |= vk::BufferUsageFlagBits::eTransferSrc;
+                break;
+            case graph_access::transfer_write:
+                resource.image_usage |= vk::ImageUsageFlagBits::eTransferDst;
+                resource.buffer_usage |= vk::BufferUsageFlagBits::eTransferDst;
+                break;
+            default:
+                throw std::runtime_error(resource.name + " is transient, it cant be acquired, presented or read by the host");
+            }
+        }
+    }
+
+    place_transients(graph, requirements);
+    simulate_barriers(graph);
+}
+
+static void record_barriers(vk::CommandBuffer command_buffer, const std::vector<vk::ImageMemoryBarrier2> &image_barriers,
+                            const std::vector<vk::BufferMemoryBarrier2> &buffer_barriers)
+{
+    if (image_barriers.empty() && buffer_barriers.empty())
+        return;
+    vk::DependencyInfo dependency = {};
+    dependency.bufferMemoryBarrierCount = buffer_barriers.size();
+    dependency.pBufferMemoryBarriers = buffer_barriers.data();
+    dependency.imageMemoryBarrierCount = image_barriers.size();
+    dependency.pImageMemoryBarriers = image_barriers.data();
+    command_buffer.pipelineBarrier2(dependency);
+}
+
+void execute_graph(const frame_graph &graph, vk::CommandBuffer command_buffer)
+{
+    for (uint32_t p : graph.order)
+    {
+        const graph_pass &pass = graph.passes[p];
+        record_barriers(command_buffer, pass.image_barriers, pass.buffer_barriers);
+        if (pass.record)
+            pass.record(command_buffer);
+    }
+    record_barriers(command_buffer, graph.final_image_barriers, graph.final_buffer_barriers);
+}
+
+static void print_barriers(const frame_graph &graph, const std::vector<vk::ImageMemoryBarrier2> &image_barriers,
+                            const std::vector<vk::BufferMemoryBarrier2> &buffer_barriers, const std::vector<graph_handle> &resources)
+{
+    for (size_t i = 0; i < image_barriers.size(); i++)
+    {
+        const vk::ImageMemoryBarrier2 &b = image_barriers[i];
+        std::println("        {}: {} {} -> {} {}, {} -> {}", graph.resources[resources[i]].name, vk::to_string(b.srcStageMask),
+                     vk::to_string(b.srcAccessMask), vk::to_string(b.dstStageMask), vk::to_string(b.dstAccessMask),
+                     vk::to_string(b.oldLayout), vk::to_string(b.newLayout));
+    }
+    for (size_t i = 0; i < buffer_barriers.size(); i++)
+    {
+        const vk::BufferMemoryBarrier2 &b = buffer_barriers[i];
+        std::println("        {}: {} {} -> {} {}", graph.resources[resources[image_barriers.size() + i]].name, vk::to_string(b.srcStageMask),
+                     vk::to_string(b.srcAccessMask), vk::to_string(b.dstStageMask), vk::to_string(b.dstAccessMask));
+    }
+}
+
+void print_graph(const frame_graph &graph)
+{
+    std::println("Frame graph: {} of {} passes ({} culled), {} barriers in {} batches, {} with a barrier before every use", graph.order.size(),
+                 graph.passes.size(), graph.passes.size() - graph.order.size(), graph.barriers, graph.barrier_batches, graph.naive_barriers);
+    for (size_t p = 0; p < graph.passes.size(); p++)
+    {
+        const graph_pass &pass = graph.passes[p];
+        if (pass.culled)
+        {
+            std::println("    {} (culled)", pass.name);
+            continue;
+        }
+        std::println("    {}, {} barriers", pass.name, pass.image_barriers.size() + pass.buffer_barriers.size());
+        print_barriers(graph, pass.image_barriers, pass.buffer_barriers, pass.barrier_resources);
+    }
+    if (!graph.final_resources.empty())
+    {
+        std::println("    after the graph, {} barriers", graph.final_resources.size());
+        print_barriers(graph, graph.final_image_barriers, graph.final_buffer_barriers, graph.final_resources);
+    }
+
+    if (graph.transient_bytes == 0)
+        return;
+    std::println("Transients: {:.2f} MiB on their own, {:.2f} MiB aliased in {} heaps", graph.transient_bytes / (1024.0 * 1024.0),
+                 graph.heap_bytes / (1024.0 * 1024.0), graph.heaps.size());
+    for (const graph_resource &resource : graph.resources)
+    {
+        if (!resource.transient || resource.first_use == unused)
+            continue;
+        std::string aliases;
+        for (graph_handle alias : resource.aliases)
+            aliases += (aliases.empty() ? " shares memory with " : ", ") + graph.resources[alias].name;
+        std::println("    {}: heap {} at {:.2f} MiB, {:.2f} MiB, passes {}-{}{}", resource.name, resource.heap, resource.offset / (1024.0 * 1024.0),
+                     resource.requirements.size / (1024.0 * 1024.0), resource.first_use, resource.last_use, aliases);
+    }
+}
+
+graph_memory create_graph_memory(const vk::Device &device, vk::PhysicalDevice selected_physical_device)
+{
+    graph_memory memory{};
+    memory.device = device;
+    memory.arena = create_device_arena(device, selected_physical_device, arena_strategy::linear, 16 * 1024 * 1024);
+    return memory;
+}
+
+void reset_graph_memory(graph_memory &memory)
+{
+    for (vk::ImageView view : memory.views)
+        memory.device.destroyImageView(view);
+    for (vk::Image image : memory.images)
+        memory.device.destroyImage(image);
+    for (vk::Buffer buffer : memory.buffers)
+        memory.device.destroyBuffer(buffer);
+    memory.views.clear();
+    memory.images.clear();
+    memory.buffers.clear();
+    memory.heaps.clear();
+    arena_reset(memory.arena);
+}
+
+graph_requirements_function graph_memory_requirements(graph_memory &memory)
+{
+    return [&memory](graph_resource &resource)
+    {
+        if (!resource.image)
+        {
+            vk::BufferCreateInfo buffer_info({}, resource.size, resource.buffer_usage, vk::SharingMode::eExclusive);
+            resource.buffer = memory.device.createBuffer(buffer_info);
+            memory.buffers.push_back(resource.buffer);
+            return memory.device.getBufferMemoryRequirements(resource.buffer);
+        }
+        vk::ImageCreateInfo image_info = {};
+        image_info.imageType = vk::ImageType::e2D;
+        image_info.format = resource.format;
+        image_info.extent = vk::Extent3D(resource.extent.width, resource.extent.height, 1);
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = vk::SampleCountFlagBits::e1;
+        image_info.tiling = vk::ImageTiling::eOptimal;
+        image_info.usage = resource.image_usage;
+        image_info.sharingMode = vk::SharingMode::eExclusive;
+        image_info.initialLayout = vk::ImageLayout::eUndefined;
+        resource.vk_image = memory.device.createImage(image_info);
+        memory.images.push_back(resource.vk_image);
+        return memory.device.getImageMemoryRequirements(resource.vk_image);
+    };
+}
+
+void bind_graph_memory(frame_graph &graph, graph_memory &memory)
+{
+    // Heaps start on an alias_granularity boundary, so they never share a page with the heap before them
+    for (const graph_heap &heap : graph.heaps)
+    {
+        vk::MemoryRequirements requirements(heap.size, heap.alignment, heap.memory_type_bits);
+        memory.heaps.push_back(arena_allocate(memory.arena, requirements, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    }
+
+    for (graph_resource &resource : graph.resources)
+    {
+        if (!resource.transient || resource.first_use == unused)
+            continue;
+        if (!resource.image)
+        {
+            memory.device.bindBufferMemory(resource.buffer, memory.heaps[resource.heap].memory, memory.heaps[resource.heap].offset + resource.offset);
+            continue;
+        }
+        memory.device.bindImageMemory(resource.vk_image, memory.heaps[resource.heap].memory, memory.heaps[resource.heap].offset + resource.offset);
+        vk::ImageViewCreateInfo view_info({}, resource.vk_image, vk::ImageViewType::e2D, resource.format, {}, view_range(resource));
+        resource.view = memory.device.createImageView(view_info);
+        memory.views.push_back(resource.view);
+    }
+}
+
+void destroy_graph_memory(graph_memory &memory)
+{
+    reset_graph_memory(memory);
+    destroy_memory_arena(memory.arena);
+    memory = graph_memory{};
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include "arena.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+// A frame described as passes that declare what they read and write. Compiling drops passes nothing needs,
+// works out the smallest set of barriers between the rest (one pipelineBarrier2 batch per pass at most)
+// and packs transient images and buffers whose lifetimes dont overlap into the same memory.
+// Passes run in the order they were added, a pass has to come after whatever it reads from
+enum class graph_access
+{
+    none,           // nothing pending, e.g. a buffer the CPU filled before submit
+    acquired,       // a swapchain image, the acquire semaphore is waited at color attachment output
+    compute_read,
+    compute_write,
+    vertex_read,    // storage buffer read in the vertex shader
+    vertex_input,   // vertex or index buffer
+    indirect_read,
+    fragment_sample,
+    color_write,
+    depth_write,
+    transfer_read,
+    transfer_write,
+    host_read,      // mapped memory the CPU reads once the submit's fence passed
+    present
+};
+
+struct graph_access_info
+{
+    vk::PipelineStageFlags2 stage;
+    vk::AccessFlags2 access;
+    vk::ImageLayout layout;
+    bool write;
+};
+
+graph_access_info describe_access(graph_access access);
+
+using graph_handle = uint32_t;
+
+struct graph_use
+{
+    graph_handle resource;
+    graph_access access;
+};
+
+// Where a resource was last touched, what a barrier has to wait for
+struct graph_state
+{
+    vk::PipelineStageFlags2 write_stage;
+    vk::AccessFlags2 write_access;
+    vk::PipelineStageFlags2 read_stages;    // reads since the last write, a write has to wait for them
+    vk::PipelineStageFlags2 visible_stages; // stages the last write was already made visible to
+    vk::AccessFlags2 visible_access;
+    vk::ImageLayout layout;
+};
+
+struct graph_resource
+{
+    std::string name;
+    bool image;
+    bool transient;
+    vk::Image vk_image;
+    vk::ImageView view;
+    vk::Buffer buffer;
+    // Transients only
+    vk::Format format;
+    vk::Extent2D extent;
+    vk::DeviceSize size;
+    vk::ImageUsageFlags image_usage;    // worked out from the passes that use it
+    vk::BufferUsageFlags buffer_usage;
+    // Imported only, graph_access::none means nothing after the graph cares about it
+    graph_access initial;
+    graph_access final;
+
+    // Filled by compile_graph
+    uint32_t first_use;     // positions in graph.order
+    uint32_t last_use;
+    vk::MemoryRequirements requirements;
+    uint32_t heap;
+    vk::DeviceSize offset;
+    std::vector<graph_handle> aliases;  // transients that used the same memory before this one
+    graph_state state;
+};
+
+struct graph_pass
+{
+    std::string name;
+    std::vector<graph_use> uses;
+    std::function<void(vk::CommandBuffer command_buffer)> record;
+    bool culled;
+    std::vector<vk::ImageMemoryBarrier2> image_barriers;    // recorded right before the pass
+    std::vector<vk::BufferMemoryBarrier2> buffer_barriers;
+    std::vector<graph_handle> barrier_resources;    // image barriers first, then buffer barriers
+};
+
+// Transients sharing a memory type mask are packed into one heap
+struct graph_heap
+{
+    uint32_t memory_type_bits;
+    vk::DeviceSize size;
+    vk::DeviceSize alignment;   // strictest of the transients in it
+};
+
+struct frame_graph
+{
+    std::vector<graph_resource> resources;
+    std::vector<graph_pass> passes;
+    // Alignment every transient gets on top of its own, bufferImageGranularity when images and buffers share a heap
+    vk::DeviceSize alias_granularity = 1;
+
+    // Filled by compile_graph
+    std::vector<uint32_t> order;    // passes that survived culling
+    std::vector<graph_heap> heaps;
+    std::vector<vk::ImageMemoryBarrier2> final_image_barriers;
+    std::vector<vk::BufferMemoryBarrier2> final_buffer_barriers;
+    std::vector<graph_handle> final_resources;
+    uint32_t barriers;
+    uint32_t barrier_batches;
+    uint32_t naive_barriers;        // one per resource use, what guarding every access on its own would emit
+    vk::DeviceSize transient_bytes; // every transient in its own allocation
+    vk::DeviceSize heap_bytes;      // after aliasing
+};
+
+// Called for every transient that survived culling, has to return its memory requirements. The device side
+// (graph_memory) creates the image or buffer in here, a CPU only caller can estimate them
+using graph_requirements_function = std::function<vk::MemoryRequirements(graph_resource &resource)>;
+
+// Empties the graph but keeps its storage for the next frame
+void begin_graph(frame_graph &graph);
+graph_handle import_image(frame_graph &graph, const std::string &name, vk::Image image, vk::ImageView view, graph_access initial, graph_access final);
+graph_handle import_buffer(frame_graph &graph, const std::string &name, vk::Buffer buffer, graph_access initial, graph_access final);
+graph_handle create_graph_image(frame_graph &graph, const std::string &name, vk::Format format, vk::Extent2D extent);
+graph_handle create_graph_buffer(frame_graph &graph, const std::string &name, vk::DeviceSize size);
+void add_graph_pass(frame_graph &graph, const std::string &name, std::vector<graph_use> uses, std::function<void(vk::CommandBuffer)> record);
+void compile_graph(frame_graph &graph, const graph_requirements_function &requirements);
+// Records every surviving pass with its barriers, then moves imported resources to their final access
+void execute_graph(const frame_graph &graph, vk::CommandBuffer command_buffer);
+void print_graph(const frame_graph &graph);
+
+// Device side of the transients, one per frame in flight. The heaps come out of a linear arena and the images
+// and buffers of a frame are destroyed when it is reset, once its fence has passed. The arena keeps its blocks,
+// so after the first few frames nothing is allocated from the device anymore
+struct graph_memory
+{
+    vk::Device device;
+    memory_arena arena;
+    std::vector<arena_allocation> heaps;
+    std::vector<vk::Image> images;
+    std::vector<vk::ImageView> views;
+    std::vector<vk::Buffer> buffers;
+};
+
+graph_memory create_graph_memory(const vk::Device &device, vk::PhysicalDevice selected_physical_device);
+void reset_graph_memory(graph_memory &memory);
+// Creates each transient as compile_graph asks for its requirements
+graph_requirements_function graph_memory_requirements(graph_memory &memory);
+// Allocates the heaps of a compiled graph, binds every transient at its offset and creates the image views
+void bind_graph_memory(frame_graph &graph, graph_memory &memory);
+void destroy_graph_memory(graph_memory &memory);
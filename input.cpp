@@ -0,0 +1,52 @@
+#include "input.hpp"
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+// Plain text, one header value per line and then one "tick action" line per input
+static constexpr const char *recording_magic = "vk_test input 2";
+
+bool save_input_recording(const std::string &path, const input_recording &recording)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+    // {} prints the shortest string that reads back as the same float, so dt round trips exactly
+    file << recording_magic << "\n";
+    file << std::format("seed {}\ndt {}\nticks {}\nscore {}\nchecksum {}\nevents {}\n", recording.seed, recording.dt, recording.ticks,
+                        recording.score, recording.checksum, recording.events.size());
+    for (auto &event: recording.events)
+        file << event.tick << (event.action == input_action::jump ? " jump\n" : " dive\n");
+    return (bool)file;
+}
+
+input_recording load_input_recording(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("cant open the recording");
+    std::string magic;
+    std::getline(file, magic);
+    if (magic != recording_magic)
+        throw std::runtime_error("not an input recording");
+
+    input_recording recording{};
+    std::string key;
+    size_t event_count = 0;
+    std::string dt;
+    file >> key >> recording.seed >> key >> dt >> key >> recording.ticks >> key >> recording.score >> key >> recording.checksum >> key >> event_count;
+    if (!file)
+        throw std::runtime_error("recording header is broken");
+    recording.dt = std::stof(dt);
+    for (size_t i = 0; i < event_count; i++)
+    {
+        recorded_input event;
+        std::string action;
+        file >> event.tick >> action;
+        if (!file || (action != "jump" && action != "dive"))
+            throw std::runtime_error("recording event " + std::to_string(i) + " is broken");
+        event.action = action == "jump" ? input_action::jump : input_action::dive;
+        recording.events.push_back(event);
+    }
+    return recording;
+}
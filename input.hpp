@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class input_action : uint8_t
+{
+    jump,
+    dive
+};
+
+// A key press as the window saw it, the simulation applies it in the first tick that ends after time
+struct input_event
+{
+    std::chrono::steady_clock::time_point time;
+    input_action action;
+};
+
+// The tick an input was actually applied in, which is all a replay needs
+struct recorded_input
+{
+    uint64_t tick;
+    input_action action;
+};
+
+// Everything needed to play a run again tick for tick, plus how it ended so the replay can be checked
+struct input_recording
+{
+    uint32_t seed;
+    float dt;
+    uint64_t ticks;
+    int score;
+    uint64_t checksum;
+    std::vector<recorded_input> events;
+};
+
+bool save_input_recording(const std::string &path, const input_recording &recording);
+// Throws if the file is missing or malformed
+input_recording load_input_recording(const std::string &path);
@@ -1,40 +1,45 @@
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 #include <print>
-#include <filesystem>
 #include <vector>
-#include <fstream>
 #include <glm/glm.hpp>
 #include <atomic>
 #include <thread>
 #include <random>
-
-bool skip_rendering = false;
-bool stop_physics = false;
-std::atomic_bool pressed_space = false;
-std::atomic_bool pressed_shift = false;
+#include <array>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include "benchmark.hpp"
+#include "memory.hpp"
+#include "stream.hpp"
+#include "mesh.hpp"
+#include "entities.hpp"
+#include "broadphase.hpp"
+#include "simulation.hpp"
+#include "pipeline_cache.hpp"
+#include "shaders.hpp"
+#include "recorder.hpp"
+#include "culling.hpp"
+#include "swapchain.hpp"
+#include "rendering.hpp"
+#include "bindless.hpp"
+#include "frame_graph.hpp"
+#include "profiler.hpp"
+#include "atlas.hpp"
+#include "sprites.hpp"
+#include "assets.hpp"
+#include "scene.hpp"
+
+bool framebuffer_resized = false;
 vk::SurfaceFormatKHR format;
 vk::Extent2D framebuffer_extension;
 
 std::vector<glm::vec2> identity_mat_2d = {{1, 0}, {0,1}};
 
-struct vertex
-{
-    glm::vec2 position;
-    glm::vec3 color;
-};
-
-struct bounding_box
-{
-    float x;
-    float y;
-    float width;
-    float height;
-    float velocityX;
-    float velocityY;
-    float accX;
-    float accY;
-};
 
 
 
@@ -43,41 +48,33 @@ struct uniform
     glm::mat4 view;
 };
 
-struct push
+// Everything a frame needs while it is in flight, one of these per slot in the ring
+struct frame_data
 {
-    glm::mat4 transform;
+    vk::CommandBuffer command_buffer;
+    vk::Fence fence;
+    vk::Semaphore image_semaphore;
+    vk::DescriptorSet descriptor_set;
+    stream_buffer instances;
+    stream_buffer sprites;
+    cull_frame cull;
+    graph_memory transients;
+    vk::Buffer bound_instances;     // what instance_slot points at
+    uint32_t instance_slot;         // bindless slot of the culled instances
+    char *uniform_data;
+    vk::DeviceSize uniform_offset;
+    double record_ms;
+    vk::DeviceSize bytes_streamed;
+    std::chrono::steady_clock::time_point submit_time;
+    bool submitted;
 };
 
-struct quad
-{
-    bounding_box box;
-    std::vector<vertex> vertices;
-    push trans;
-};
-
-bounding_box player;
-float velocityX = 1.0f;
-float velocityY = 0.50f;
-std::atomic_bool thread = true;
-
-std::vector<char> read_file(const char *filename)
-{
-    std::ifstream file(filename, std::ios::binary);
-    file.seekg(0,std::ios::end);
-    std::streampos length = file.tellg();
-    file.seekg(0,std::ios::beg);
-    std::vector<char> buffer(length);
-    file.read(&buffer[0],length);
-
-    return buffer;
-}
-
 GLFWwindow *create_window(int width, int height, const char *title)
 {
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     GLFWwindow *window = glfwCreateWindow(width, height, title, nullptr, nullptr);
 
@@ -108,79 +105,34 @@ vk::PhysicalDevice select_physical_device(std::vector<vk::PhysicalDevice> device
     return selected_physical_device; 
 }
 
-vk::SwapchainKHR create_swapchain(vk::PhysicalDevice phy_device, vk::SurfaceKHR surface, GLFWwindow *window, vk::Device device)
+std::pair<vk::DeviceMemory, vk::Image> create_offscreen_image(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::Format image_format, vk::Extent2D extent)
 {
-    vk::SurfaceCapabilitiesKHR surface_capabilities = phy_device.getSurfaceCapabilitiesKHR(surface);
-    int width = 0;
-    int height = 0;
-    if (surface_capabilities.currentExtent.height == UINT32_MAX || surface_capabilities.currentExtent.width == UINT32_MAX)
-    {
-        glfwGetFramebufferSize(window, &width, &height);
-        width = std::clamp((uint32_t)width, surface_capabilities.minImageExtent.width, surface_capabilities.maxImageExtent.width);
-        height = std::clamp((uint32_t)height, surface_capabilities.minImageExtent.height, surface_capabilities.maxImageExtent.height);
-    }
-    else
-    {
-        width = surface_capabilities.currentExtent.width;
-        height = surface_capabilities.currentExtent.height;
-    }
-    
-    
-    if (width == 0 && height == 0)
-    {
-        skip_rendering = true;
-    }
-    framebuffer_extension = vk::Extent2D(width, height);
-    std::println("Extents width {} height {}", width, height);
-
-    std::vector<vk::SurfaceFormatKHR> surface_formats = phy_device.getSurfaceFormatsKHR(surface);
-
-    for (auto form: surface_formats)
-    {
-        if (form.format == vk::Format::eB8G8R8A8Srgb && form.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear)
-        {
-            format = form;
-            break;
-        }
-    }
+    vk::ImageCreateInfo image_info = {};
+    image_info.imageType = vk::ImageType::e2D;
+    image_info.format = image_format;
+    image_info.extent = vk::Extent3D(extent.width, extent.height, 1);
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = vk::SampleCountFlagBits::e1;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+    image_info.sharingMode = vk::SharingMode::eExclusive;
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+    vk::Image image = device.createImage(image_info);
+
+    vk::MemoryRequirements memory_requirements = device.getImageMemoryRequirements(image);
+    vk::PhysicalDeviceMemoryProperties memory_properties = selected_physical_device.getMemoryProperties();
 
-    std::vector<vk::PresentModeKHR> present_modes = phy_device.getSurfacePresentModesKHR(surface);
-    vk::PresentModeKHR mode = vk::PresentModeKHR::eFifo;
-    if (std::find(present_modes.begin(), present_modes.end(), vk::PresentModeKHR::eFifoRelaxed) != present_modes.end())
-    {
-        mode = vk::PresentModeKHR::eFifoRelaxed;
-        std::println("Selected relaxed FIFO");
-    }
-    else 
+    int propierty_index = find_memory_type(memory_properties, memory_requirements.memoryTypeBits, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (propierty_index == -1)
     {
-        std::println("Selected FIFO");
+        throw std::runtime_error("Didnt find a suitable memory for the offscreen image");
     }
-    
-    vk::SwapchainCreateInfoKHR swapchain_info = vk::SwapchainCreateInfoKHR(vk::SwapchainCreateFlagsKHR(), surface, 2, format.format, format.colorSpace, framebuffer_extension,
-        1, vk::ImageUsageFlagBits::eColorAttachment, vk::SharingMode::eExclusive);
-    swapchain_info.preTransform = surface_capabilities.currentTransform;
-    swapchain_info.presentMode = mode;
-    swapchain_info.clipped = VK_TRUE;
-    swapchain_info.oldSwapchain = vk::SwapchainKHR(nullptr);
-    swapchain_info.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
 
-
-    return device.createSwapchainKHR(swapchain_info);
-}
-
-void compile_shader(const char *filename)
-{
-    system(std::format("glslc {} -o {}.spv", filename, filename).c_str());
-}
-
-std::vector<vertex> convert_quad_to_triangles(std::vector<vertex> vertices)
-{
-    const vertex end_vertex = vertices[3];
-    vertices.pop_back();
-    vertices.push_back(vertices[0]);
-    vertices.push_back(vertices[2]);
-    vertices.push_back(end_vertex);
-    return vertices;
+    vk::MemoryAllocateInfo alloc_info = vk::MemoryAllocateInfo(memory_requirements.size, propierty_index);
+    vk::DeviceMemory image_memory = device.allocateMemory(alloc_info);
+    device.bindImageMemory(image, image_memory, 0);
+    return std::make_pair(image_memory, image);
 }
 
 glm::mat4 rotate(float angle)
@@ -203,175 +155,225 @@ glm::mat4 move(glm::vec2 pos)
     return transform;
 }
 
-void simple_physics()
+// Everything the game draws textured, packed into one atlas at startup
+struct game_sprites
 {
-    while (thread.load() == true)
-    {
-        bool collision_x = player.x + player.width / 2 >= 1.0f || player.x - player.width / 2 <= -1.0f;
-        bool collision_y = player.y + player.height / 2 >=1.0f || player.y - player.height / 2 <= -1.0f;
-        if (collision_x)
-            velocityX = -velocityX;
-        else if (collision_y)
-            velocityY = -velocityY;
-        player.x = player.x + (velocityX * 0.002f);
-        player.y = player.y + (velocityY * 0.002f);
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
-    }
-}
+    texture_atlas atlas;
+    std::array<sprite_region, 10> digits;
+    sprite_region face;
+};
 
-bool simple_physics_step(float t, bounding_box &box, std::vector<quad> &boxes, bool &on_ground)
+// No art assets yet, so the sprites are drawn here: 7 segment digits for the score and a face for the player
+game_sprites build_game_sprites()
 {
-    box.y += box.velocityY * t + 0.5 * box.accY * (t * t);
-    box.velocityY += box.accY * t;
-
-    box.x += box.velocityX * t + 0.5 * box.accX * (t * t);
-    box.velocityX += box.accX * t;
-    bool end_game = false;
-
-    for (auto &b: boxes)
+    game_sprites sprites;
+    sprites.atlas = create_texture_atlas(256);
+    const uint32_t white = 0xFFFFFFFF;
+    const uint32_t dark = 0xFF202020;
+
+    // Segments a to g, bit 0 is the top one, going clockwise and ending with the middle
+    const std::array<uint8_t, 10> segments = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    const uint32_t digit_width = 5, digit_height = 9;
+    for (uint32_t digit = 0; digit < 10; digit++)
     {
-        b.box.y += b.box.velocityY * t + 0.5 * b.box.accY * (t * t);
-        b.box.velocityY += b.box.accY * t;
-
-        b.box.x += b.box.velocityX * t + 0.5 * b.box.accX * (t * t);
-        b.box.velocityX += b.box.accX * t;
-
-        bool collision_x = b.box.x + b.box.width / 2 >= box.x - box.width /2 && b.box.x - b.box.width / 2 <= box.x + box.width /2;
-        bool collision_y = b.box.y + b.box.height / 2 >= box.y - box.height /2 && b.box.y - b.box.height / 2 <= box.y + box.height /2;
-        end_game = collision_x && collision_y;
-        if (end_game)
+        std::vector<uint32_t> pixels(digit_width * digit_height, 0);
+        auto fill = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
         {
-            #ifdef NDEBUG
-            std::println("Collision between pos x: {} y: {} and pos x: {} and pos y: {} ", box.x, box.y, b.box.x, b.box.y);
-            std::println("With width: {} and height: {} and width: {} and height: {}", box.width, box.height, b.box.width, b.box.height);
-            std::println("Rightmost vertex in position {} collided with leftmost vertex in position {}", box.x + box.width/2, b.box.x - b.box.width/2);
-            #endif
-        }
+            for (uint32_t y = y0; y <= y1; y++)
+                for (uint32_t x = x0; x <= x1; x++)
+                    pixels[y * digit_width + x] = white;
+        };
+        uint8_t mask = segments[digit];
+        if (mask & 0x01) fill(1, 0, 3, 0);
+        if (mask & 0x02) fill(4, 1, 4, 3);
+        if (mask & 0x04) fill(4, 5, 4, 7);
+        if (mask & 0x08) fill(1, 8, 3, 8);
+        if (mask & 0x10) fill(0, 5, 0, 7);
+        if (mask & 0x20) fill(0, 1, 0, 3);
+        if (mask & 0x40) fill(1, 4, 3, 4);
+        sprites.digits[digit] = atlas_add_image(sprites.atlas, pixels.data(), digit_width, digit_height);
     }
 
-    bool collision_x = box.x + box.width / 2 >= 1.0f || box.x - box.width / 2 <= -1.0f;
-    bool collision_top_y = box.y - box.height / 2 <= -1.0f;
-    bool collision_bottom_y = box.y + box.height / 2 >=1.0f;
-    if (collision_x)
-        box.velocityX = 0;
-    else if (collision_top_y)
-    {
-        box.velocityY = 0;
-        box.y = -1.0f + box.height/2;
-    }
-    else if (collision_bottom_y)
-    {
-        box.velocityY = 0.0f;
-        box.y = 1.0f - box.height/2;
-        on_ground = true;
-    }
-    return end_game;
+    // Drawn over the player quad, only the eyes and mouth are opaque
+    const char *face[] = {
+        "........",
+        "........",
+        "..#..#..",
+        "..#..#..",
+        "........",
+        ".#....#.",
+        "..####..",
+        "........",
+    };
+    std::vector<uint32_t> pixels(64, 0);
+    for (uint32_t y = 0; y < 8; y++)
+        for (uint32_t x = 0; x < 8; x++)
+            pixels[y * 8 + x] = face[y][x] == '#' ? dark : 0;
+    sprites.face = atlas_add_image(sprites.atlas, pixels.data(), 8, 8);
+    return sprites;
 }
 
-std::pair<vk::DeviceMemory, vk::Buffer> create_buffer(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::BufferUsageFlagBits usage, size_t size)
+void framebuffer_resize_handle(GLFWwindow *window, int width, int height)
 {
-    vk::BufferCreateInfo buffer_info = vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage, vk::SharingMode::eExclusive);
-    vk::Buffer vertex_buffer = device.createBuffer(buffer_info);
-    VkMemoryRequirements memory_requirements;
-    vkGetBufferMemoryRequirements(device, vertex_buffer, &memory_requirements);
-    vk::PhysicalDeviceMemoryProperties memory_properties = selected_physical_device.getMemoryProperties();
-
-    int propierty_index = -1;
-    for (int i = 0; i < memory_properties.memoryTypeCount; i++)
-    {
-        if (memory_properties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent))
-        {
-            propierty_index = i;
-            break;
-        }
-    }
-    if (propierty_index == -1)
-    {
-        throw std::runtime_error("Didnt find a suitable memory");
-    }
-
-    vk::MemoryAllocateInfo alloc_info = vk::MemoryAllocateInfo(memory_requirements.size, propierty_index);
-
-    vk::DeviceMemory vertex_buffer_memory = device.allocateMemory(alloc_info);
-    device.bindBufferMemory(vertex_buffer, vertex_buffer_memory, 0);
-    return std::make_pair(vertex_buffer_memory, vertex_buffer);
+    framebuffer_resized = true;
 }
 
 void keyboard_handle(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
-    {
-        //std::println("JUMP!");
-        pressed_space = true;
-    }
-    else if (key == GLFW_KEY_LEFT_SHIFT && action == GLFW_PRESS)
-    {
-        pressed_shift = true;
-    }
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        exit(0);
+    simulation *sim = (simulation*)glfwGetWindowUserPointer(window);
+    if (action != GLFW_PRESS)
+        return;
+    // Stamped now so the simulation can put it in the right tick, not whenever it gets around to it
+    auto now = std::chrono::steady_clock::now();
+    bool queued = true;
+    if (key == GLFW_KEY_SPACE)
+        queued = sim->input.push({now, input_action::jump});
+    else if (key == GLFW_KEY_LEFT_SHIFT)
+        queued = sim->input.push({now, input_action::dive});
+    else if (key == GLFW_KEY_ESCAPE)
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    if (!queued)
+        std::println("Input queue is full, dropped a key press");
 }
 
-bounding_box spawn_enemy(std::mt19937 rng)
+int main(int argc, char **argv)
 {
-    std::uniform_real_distribution<float> dist(0.05, 0.4);
-    std::uniform_real_distribution<float> y_dist(0.6, 0.9);
-    std::uniform_real_distribution<float> vel_dist(-1.5, -0.5);
-    bounding_box ret{0};
-    ret.height = dist(rng);
-    ret.width = dist(rng);
-    ret.x = 0.8;
-    ret.y = y_dist(rng);
-    ret.velocityX = vel_dist(rng);
-    return ret;
-}
-
-void add_quad_to_vertices(std::vector<vertex> &vertices, std::vector<vertex> new_quad)
-{
-    new_quad = convert_quad_to_triangles(new_quad);
-
-    for (auto vert: new_quad)
+    using ms = std::chrono::duration<double, std::milli>;
+    auto startup_begin = std::chrono::steady_clock::now();
+    bool headless = false;
+    bool use_pipeline_cache = true;
+    uint32_t record_threads = 1;
+    uint32_t bench_record_draws = 0;
+    swapchain_config present_config;
+    const char *trace_path = nullptr;
+    const char *asset_directory = nullptr;
+    const char *scene_path = nullptr;
+    const char *record_input_path = nullptr;
+    const char *replay_input_path = nullptr;
+    transform_format transforms = transform_format::affine_2d;
+    uint32_t frame_count = 1000;
+    uint32_t frames_in_flight = 2;
+    for (int i = 1; i < argc; i++)
     {
-        //std::println("Vertex pos x: {}, y: {}, z: {}", vert.position.x, vert.position.y, vert.position.z);
-        vertices.push_back(vert);
+        std::string_view arg = argv[i];
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            frame_count = std::stoul(argv[++i]);
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+            frames_in_flight = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--record-threads" && i + 1 < argc)
+            record_threads = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--bench-record" && i + 1 < argc)
+        {
+            // Needs a device but no window
+            bench_record_draws = std::stoul(argv[++i]);
+            headless = true;
+        }
+        else if (arg == "--present-mode" && i + 1 < argc && parse_present_policy(argv[i + 1], present_config.policy))
+            i++;
+        else if (arg == "--swapchain-images" && i + 1 < argc)
+            present_config.image_count = std::stoul(argv[++i]);
+        else if (arg == "--transforms" && i + 1 < argc)
+        {
+            std::string_view name = argv[++i];
+            if (name != "affine" && name != "matrix")
+            {
+                std::println("--transforms takes affine or matrix");
+                return -1;
+            }
+            transforms = name == "matrix" ? transform_format::matrix : transform_format::affine_2d;
+        }
+        else if (arg == "--profile" && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (arg == "--assets" && i + 1 < argc)
+            asset_directory = argv[++i];
+        else if (arg == "--scene" && i + 1 < argc)
+            scene_path = argv[++i];
+        else if (arg == "--record-input" && i + 1 < argc)
+            record_input_path = argv[++i];
+        else if (arg == "--replay-input" && i + 1 < argc)
+        {
+            // Replays tick for tick on the main thread, which is what headless does
+            replay_input_path = argv[++i];
+            headless = true;
+        }
+        else if (arg == "--no-pipeline-cache")
+            use_pipeline_cache = false;
+        else if (arg == "--bench-physics")
+        {
+            return run_physics_benchmark() ? 0 : 1;
+        }
+        else if (arg == "--bench-broadphase")
+        {
+            return run_broadphase_benchmark() ? 0 : 1;
+        }
+        else if (arg == "--bench-spawn")
+        {
+            return run_spawn_benchmark() ? 0 : 1;
+        }
+        else if (arg == "--bench-atlas")
+        {
+            return run_atlas_benchmark() ? 0 : 1;
+        }
+        else if (arg == "--bench-arena")
+        {
+            return run_arena_benchmark() ? 0 : 1;
+        }
+        else if (arg == "--bench-graph")
+        {
+            return run_graph_benchmark() ? 0 : 1;
+        }
+        else
+        {
+            std::println("Usage: {} [--headless] [--frames N] [--frames-in-flight N] [--present-mode fifo|relaxed|mailbox|immediate] [--swapchain-images N] [--no-pipeline-cache] [--record-threads N] [--bench-record DRAWS] [--transforms affine|matrix] [--profile TRACE.json] [--assets DIR] [--scene LEVEL] [--record-input FILE] [--replay-input FILE] [--bench-physics] [--bench-broadphase] [--bench-spawn] [--bench-atlas] [--bench-arena] [--bench-graph]", argv[0]);
+            return -1;
+        }
     }
-}
-
-std::vector<vertex> bounding_box_to_vertices(const bounding_box &box)
-{
-    float half_width = box.width/2;
-    float half_height = box.height/2;
-    std::vector<vertex> vertices = {
-        {{-half_width, -half_height}, {1.0f, 0.0f, 0.0f}},
-        {{half_width, -half_height}, {1.0f, 0.0f, 0.0f}},
-        {{half_width, half_height}, {0.0f, 1.0f, 0.0f}},
-        {{-half_width, half_height}, {0.0f, 0.0f, 1.0f}}
-    };
-    return vertices;
-}
 
-int main()
-{
-    using clock = std::chrono::system_clock;
-    using ms = std::chrono::duration<double, std::milli>;
-    GLFWwindow *window = create_window(1000, 800, "hello");
+    GLFWwindow *window = nullptr;
+    if (!headless)
+    {
+        window = create_window(1000, 800, "hello");
+        if (!window)
+            return -1;
+    }
     std::random_device dev;
-    std::mt19937 rng(dev());
-
-    if (!window)
-        return -1;
+    uint32_t seed = dev();
+    float headless_dt = 1.0f / 60.0f;
+    input_recording replay{};
+    if (replay_input_path)
+    {
+        try
+        {
+            replay = load_input_recording(replay_input_path);
+        }
+        catch (std::exception &e)
+        {
+            std::println("Cant replay {}: {}", replay_input_path, e.what());
+            return -1;
+        }
+        // Same seed, same dt and as many ticks as the recording had, one per frame
+        seed = replay.seed;
+        headless_dt = replay.dt;
+        frame_count = replay.ticks;
+        std::println("Replaying {} inputs over {} ticks from {}", replay.events.size(), replay.ticks, replay_input_path);
+    }
 
     vk::ApplicationInfo appinfo = vk::ApplicationInfo("Test_vk", VK_MAKE_VERSION(0,1,0), NULL, VK_MAKE_VERSION(0,1,0), VK_API_VERSION_1_4);
     
-    uint32_t extension_count = 0;
-    const char **glfwextensions = glfwGetRequiredInstanceExtensions(&extension_count);
-    std::println("GLFW requested extensions:");
     std::vector<const char *> extensions;
     std::vector<const char *> layers;
-    for (int i = 0; i < extension_count;i++)
+    if (!headless)
     {
-        extensions.push_back(glfwextensions[i]);
-        std::println("{}", glfwextensions[i]);
+        uint32_t extension_count = 0;
+        const char **glfwextensions = glfwGetRequiredInstanceExtensions(&extension_count);
+        std::println("GLFW requested extensions:");
+        for (int i = 0; i < extension_count;i++)
+        {
+            extensions.push_back(glfwextensions[i]);
+            std::println("{}", glfwextensions[i]);
+        }
     }
     #ifdef __APPLE__
     extensions.push_back("VK_KHR_portability_enumeration");
@@ -407,40 +409,120 @@ int main()
             break;
         }
     }
+    // A transfer only family is usually a dedicated DMA engine, uploads there dont compete with rendering
+    uint32_t transfer_queue_index = graphics_queue_index;
+    for (uint32_t i = 0; i < queue_families.size(); i++)
+    {
+        if ((queue_families[i].queueFlags & vk::QueueFlagBits::eTransfer) && !(queue_families[i].queueFlags & vk::QueueFlagBits::eGraphics)
+            && !(queue_families[i].queueFlags & vk::QueueFlagBits::eCompute))
+        {
+            transfer_queue_index = i;
+            break;
+        }
+    }
     float queue_priority = 1.0f;
-    vk::DeviceQueueCreateInfo queue_info = vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), graphics_queue_index, 1, &queue_priority);
+    std::vector<vk::DeviceQueueCreateInfo> queue_infos;
+    queue_infos.push_back(vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), graphics_queue_index, 1, &queue_priority));
+    if (transfer_queue_index != graphics_queue_index)
+    {
+        queue_infos.push_back(vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), transfer_queue_index, 1, &queue_priority));
+        std::println("Using queue family {} for transfers", transfer_queue_index);
+    }
 
     std::vector<const char *> device_extensions;
 
-    device_extensions.push_back("VK_KHR_swapchain");
+    if (!headless)
+        device_extensions.push_back("VK_KHR_swapchain");
     #ifdef __APPLE__
     device_extensions.push_back("VK_KHR_portability_subset");
     #endif
+    // Each recording thread draws its share of the culled instances, which starts at a first instance above 0
     vk::PhysicalDeviceFeatures device_features = vk::PhysicalDeviceFeatures();
-
-    vk::DeviceCreateInfo device_info = vk::DeviceCreateInfo(vk::DeviceCreateFlags(), 1, &queue_info, 0, nullptr, device_extensions.size(), device_extensions.data(), &device_features);
+    device_features.drawIndirectFirstInstance = VK_TRUE;
+    // The bindless heap indexes its buffer and texture arrays with values that arent compile time constants
+    device_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    // The asset loader tracks its uploads with a timeline semaphore, drawing uses dynamic rendering instead of render passes
+    // and reads buffers and textures out of the bindless heap, the frame graph records synchronization2 barriers
+    auto supported_features = selected_physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features>();
+    const vk::PhysicalDeviceFeatures &supported10 = supported_features.get<vk::PhysicalDeviceFeatures2>().features;
+    if (!supported10.drawIndirectFirstInstance)
+        throw std::runtime_error("The device doesnt support indirect draws with a first instance");
+    const vk::PhysicalDeviceVulkan12Features &supported12 = supported_features.get<vk::PhysicalDeviceVulkan12Features>();
+    if (!supported12.timelineSemaphore)
+        throw std::runtime_error("The device doesnt support timeline semaphores");
+    if (!supported10.shaderStorageBufferArrayDynamicIndexing || !supported10.shaderSampledImageArrayDynamicIndexing
+        || !supported12.runtimeDescriptorArray || !supported12.descriptorBindingPartiallyBound || !supported12.descriptorBindingStorageBufferUpdateAfterBind
+        || !supported12.descriptorBindingSampledImageUpdateAfterBind || !supported12.descriptorBindingUpdateUnusedWhilePending
+        || !supported12.shaderSampledImageArrayNonUniformIndexing)
+        throw std::runtime_error("The device doesnt support the descriptor indexing the bindless heap needs");
+    if (!supported_features.get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering)
+        throw std::runtime_error("The device doesnt support dynamic rendering");
+    if (!supported_features.get<vk::PhysicalDeviceVulkan13Features>().synchronization2)
+        throw std::runtime_error("The device doesnt support synchronization2");
+    vk::PhysicalDeviceVulkan13Features vulkan13_features = {};
+    vulkan13_features.dynamicRendering = VK_TRUE;
+    vulkan13_features.synchronization2 = VK_TRUE;
+    vk::PhysicalDeviceVulkan12Features vulkan12_features = {};
+    vulkan12_features.timelineSemaphore = VK_TRUE;
+    vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    vulkan12_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    vulkan12_features.pNext = &vulkan13_features;
+
+    vk::DeviceCreateInfo device_info = vk::DeviceCreateInfo(vk::DeviceCreateFlags(), queue_infos.size(), queue_infos.data(), 0, nullptr, device_extensions.size(), device_extensions.data(), &device_features);
+    device_info.pNext = &vulkan12_features;
 
     vk::Device device = selected_physical_device.createDevice(device_info);
 
     vk::Queue graphics_queue = device.getQueue(graphics_queue_index, 0);
+    vk::Queue transfer_queue = device.getQueue(transfer_queue_index, 0);
+    std::vector<uint32_t> static_buffer_families = {graphics_queue_index};
+    if (transfer_queue_index != graphics_queue_index)
+        static_buffer_families.push_back(transfer_queue_index);
+
+    vk::SurfaceKHR surface;
+    window_swapchain swapchain{};
+    std::vector<vk::Image> images;
+    std::vector<vk::DeviceMemory> offscreen_memory;
+    if (headless)
+    {
+        // Render into plain images instead of the swapchain, no display needed.
+        // One per frame in flight so frames dont write over each other
+        format.format = vk::Format::eR8G8B8A8Unorm;
+        format.colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
+        framebuffer_extension = vk::Extent2D(1000, 800);
+        for (uint32_t i = 0; i < frames_in_flight; i++)
+        {
+            auto offscreen = create_offscreen_image(device, selected_physical_device, format.format, framebuffer_extension);
+            offscreen_memory.push_back(offscreen.first);
+            images.push_back(offscreen.second);
+        }
+        std::println("Headless mode, rendering {} frames offscreen on {}", frame_count, selected_physical_device.getProperties().deviceName.data());
+    }
+    else
+    {
+        VkSurfaceKHR raw_surface;
+        glfwCreateWindowSurface(instance, window, nullptr, &raw_surface);
+        surface = raw_surface;
 
-    VkSurfaceKHR raw_surface;
-    glfwCreateWindowSurface(instance, window, nullptr, &raw_surface);
-    vk::SurfaceKHR surface = raw_surface;
-
-    VkBool32 surface_supported = selected_physical_device.getSurfaceSupportKHR(graphics_queue_index, surface);
+        VkBool32 surface_supported = selected_physical_device.getSurfaceSupportKHR(graphics_queue_index, surface);
 
-    if (surface_supported == VK_TRUE)
-        std::println("Surface supported!");
-    else
-        std::println("Surface unsupported!");
+        if (surface_supported == VK_TRUE)
+            std::println("Surface supported!");
+        else
+            std::println("Surface unsupported!");
 
-    
-    vk::SwapchainKHR swapchain = create_swapchain(selected_physical_device, surface, window, device);
-    
-    std::vector<vk::Image> images = device.getSwapchainImagesKHR(swapchain);
-    std::println("Got {} images from swapchain", images.size());
+        swapchain = create_window_swapchain(device, selected_physical_device, surface, window, present_config);
+        format = swapchain.format;
+        framebuffer_extension = swapchain.extent;
+        glfwSetFramebufferSizeCallback(window, framebuffer_resize_handle);
+    }
 
+    // Only the offscreen images, the swapchain keeps its own views
     std::vector<vk::ImageView> image_views;
     for (auto &image: images)
     {
@@ -460,33 +542,21 @@ int main()
 
         image_views.push_back(device.createImageView(image_view_info));
     }
-    if (!std::filesystem::exists("../shaders/vertex.vert.spv") && !std::filesystem::exists("../shaders/fragment.frag.spv"))
-    {    
-        std::println("Compiling shaders");
-        compile_shader("../shaders/vertex.vert");
-        compile_shader("../shaders/fragment.frag");
-        std::println("Shaders compiled");
-    }
-    std::vector<char> vertex_shader = read_file("../shaders/vertex.vert.spv");
-    std::vector<char> fragment_shader = read_file("../shaders/fragment.frag.spv");
-    
-    vk::ShaderModuleCreateInfo vertex_shader_info = vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), vertex_shader.size());
-    vertex_shader_info.pCode = (const uint32_t*)(vertex_shader.data());
-
-    vk::ShaderModuleCreateInfo fragment_shader_info = vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), fragment_shader.size());
-    fragment_shader_info.pCode = (const uint32_t*)(fragment_shader.data());
-
-    vk::ShaderModule vertex_module = device.createShaderModule(vertex_shader_info);
-    vk::ShaderModule fragment_module = device.createShaderModule(fragment_shader_info);
+    shader_registry shaders = create_shader_registry(device);
 
     vk::PipelineShaderStageCreateInfo vertex_stage_info = {};
     vertex_stage_info.stage = vk::ShaderStageFlagBits::eVertex;
-    vertex_stage_info.module = vertex_module;
+    vertex_stage_info.module = get_shader_module(shaders, shader_id::vertex);
     vertex_stage_info.pName = "main";
+    // Constant 0 picks the instance layout the shader reads, see vertex.vert
+    vk::Bool32 full_transform = transforms == transform_format::matrix;
+    vk::SpecializationMapEntry specialization_entry(0, 0, sizeof(vk::Bool32));
+    vk::SpecializationInfo specialization_info(1, &specialization_entry, sizeof(vk::Bool32), &full_transform);
+    vertex_stage_info.pSpecializationInfo = &specialization_info;
 
     vk::PipelineShaderStageCreateInfo fragment_stage_info = {};
     fragment_stage_info.stage = vk::ShaderStageFlagBits::eFragment;
-    fragment_stage_info.module = fragment_module;
+    fragment_stage_info.module = get_shader_module(shaders, shader_id::fragment);
     fragment_stage_info.pName = "main";
 
     std::vector<vk::PipelineShaderStageCreateInfo> pipeline_shaders = {vertex_stage_info, fragment_stage_info};
@@ -508,31 +578,27 @@ int main()
     att_description_color.format = vk::Format::eR32G32B32Sfloat;
     att_description_color.offset = offsetof(vertex, color);
 
+    // Instances arent vertex input anymore, the shader reads them from a storage buffer by gl_InstanceIndex
+    std::vector<vk::VertexInputBindingDescription> binding_descriptions = {binding_description};
     std::vector<vk::VertexInputAttributeDescription> att_descriptions = {att_description_pos, att_description_color};
     vk::PipelineVertexInputStateCreateInfo vertex_input_info = {};
-    vertex_input_info.vertexAttributeDescriptionCount = 2;
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.pVertexBindingDescriptions = &binding_description;
+    vertex_input_info.vertexAttributeDescriptionCount = att_descriptions.size();
+    vertex_input_info.vertexBindingDescriptionCount = binding_descriptions.size();
+    vertex_input_info.pVertexBindingDescriptions = binding_descriptions.data();
     vertex_input_info.pVertexAttributeDescriptions = att_descriptions.data();
 
 
+    // Only the topology class (triangles) is baked in, which kind of triangles is set while recording
     vk::PipelineInputAssemblyStateCreateInfo input_assembly_info = vk::PipelineInputAssemblyStateCreateInfo(vk::PipelineInputAssemblyStateCreateFlags(), 
                                                                                                             vk::PrimitiveTopology::eTriangleList, VK_FALSE);
-    vk::Viewport viewport = vk::Viewport(0.0f, 0.0f, 
-                                        framebuffer_extension.width, framebuffer_extension.height,
-                                        0.0f, 1.0f);
-    vk::Rect2D scissor;
-    scissor.setOffset({0, 0});
-    scissor.extent = framebuffer_extension;
-
     vk::PipelineViewportStateCreateInfo viewport_info = vk::PipelineViewportStateCreateInfo(vk::PipelineViewportStateCreateFlags(), 
-                                                                                            1, &viewport, 1, &scissor);
+                                                                                            1, nullptr, 1, nullptr);
+    // Viewport, scissor, culling and topology are set while recording, see rendering.hpp
+    vk::PipelineDynamicStateCreateInfo dynamic_state_info(vk::PipelineDynamicStateCreateFlags(), pipeline_dynamic_states.size(), pipeline_dynamic_states.data());
     vk::PipelineRasterizationStateCreateInfo raster_info = {};
     raster_info.depthClampEnable = VK_FALSE;
     raster_info.polygonMode = vk::PolygonMode::eFill;
     raster_info.lineWidth = 1.0f;
-    raster_info.cullMode = vk::CullModeFlagBits::eNone;
-    raster_info.frontFace = vk::FrontFace::eClockwise;
     raster_info.depthBiasEnable = VK_FALSE;
 
     vk::PipelineMultisampleStateCreateInfo multisampling_info = {};
@@ -546,7 +612,8 @@ int main()
     color_blend_info.attachmentCount = 1;
     color_blend_info.pAttachments = &color_blend_attachment;
 
-    vk::DescriptorSetLayoutBinding descriptor_binding;
+    // Set 0 is only the frame's view, everything else is looked up by slot in the bindless heap (set 1)
+    vk::DescriptorSetLayoutBinding descriptor_binding = {};
     descriptor_binding.binding = 0;
     descriptor_binding.descriptorCount = 1;
     descriptor_binding.descriptorType = vk::DescriptorType::eUniformBuffer;
@@ -555,50 +622,40 @@ int main()
     vk::DescriptorSetLayoutCreateInfo descriptor_layout_info(vk::DescriptorSetLayoutCreateFlags(), 1, &descriptor_binding);
     vk::DescriptorSetLayout descriptor_layout = device.createDescriptorSetLayout(descriptor_layout_info);
 
-    vk::PushConstantRange push_constant(vk::ShaderStageFlags(vk::ShaderStageFlagBits::eVertex), 0, sizeof(push));
+    bindless_heap bindless = create_bindless_heap(device, selected_physical_device, frames_in_flight, 1024, 4096, 16);
+    // Every graphics pipeline shares it, so the sets are bound once per command buffer
+    vk::PipelineLayout pipeline_layout = create_bindless_pipeline_layout(bindless, descriptor_layout);
 
-    vk::PipelineLayoutCreateInfo layout_info = {};
-    layout_info.setLayoutCount = 1;
-    layout_info.pSetLayouts = &descriptor_layout;
-    layout_info.pushConstantRangeCount = 1;
-    layout_info.pPushConstantRanges = &push_constant;
-    vk::PipelineLayout pipeline_layout = device.createPipelineLayout(layout_info);
+    // Every long lived buffer is carved out of this arena instead of getting its own allocation
+    memory_arena buffer_arena = create_device_arena(device, selected_physical_device, arena_strategy::free_list, 64 * 1024 * 1024);
 
     uniform u{};
     u.view = glm::mat4(1.0f);
-    auto rec = create_buffer(device, selected_physical_device, vk::BufferUsageFlagBits::eUniformBuffer, sizeof(uniform));
-    vk::DeviceMemory uniform_buffer_data = rec.first;
+    // Each frame in flight gets its own slice of the uniform buffer, aligned for dynamic offsets
+    vk::DeviceSize uniform_alignment = selected_physical_device.getProperties().limits.minUniformBufferOffsetAlignment;
+    vk::DeviceSize uniform_slice_size = (sizeof(uniform) + uniform_alignment - 1) & ~(uniform_alignment - 1);
+    auto rec = create_arena_buffer(device, buffer_arena, vk::BufferUsageFlagBits::eUniformBuffer, uniform_slice_size * frames_in_flight,
+                                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    arena_allocation uniform_allocation = rec.first;
     vk::Buffer uniform_buffer = rec.second;
-    char *uniform_data = (char *)device.mapMemory(uniform_buffer_data, 0, sizeof(uniform));
-    memcpy(uniform_data, &u, sizeof(uniform));
-
-    vk::AttachmentDescription color_attachment = vk::AttachmentDescription(vk::AttachmentDescriptionFlags(), 
-                                                                            format.format, vk::SampleCountFlagBits::e1,
-                                                                            vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
-                                                                            vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                                                                            vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
-    vk::AttachmentReference attachment_ref = vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
-    vk::SubpassDescription subpass_description = {};
-    subpass_description.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-    subpass_description.colorAttachmentCount = 1;
-    subpass_description.pColorAttachments = &attachment_ref;
-
-    vk::SubpassDependency subpass_dependency = {};
-    subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpass_dependency.dstSubpass = 0;
-    subpass_dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    subpass_dependency.dstStageMask = vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    subpass_dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
-
-    vk::RenderPassCreateInfo render_pass_info = {};
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &subpass_description;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &subpass_dependency;
-
-    vk::RenderPass render_pass = device.createRenderPass(render_pass_info);
+    char *uniform_data = uniform_allocation.mapped;
+    for (uint32_t i = 0; i < frames_in_flight; i++)
+        memcpy(uniform_data + uniform_slice_size * i, &u, sizeof(uniform));
+    // Culling happens in world space, so the screen corners go back through the view to find what is visible
+    glm::mat4 inverse_view = glm::inverse(u.view);
+    glm::vec2 view_min = glm::vec2(FLT_MAX);
+    glm::vec2 view_max = glm::vec2(-FLT_MAX);
+    for (glm::vec2 corner: {glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-1.0f, 1.0f)})
+    {
+        glm::vec4 world = inverse_view * glm::vec4(corner, 0.0f, 1.0f);
+        view_min = glm::min(view_min, glm::vec2(world) / world.w);
+        view_max = glm::max(view_max, glm::vec2(world) / world.w);
+    }
+
+    // No render pass, pipelines only need to know the format they draw into
+    vk::PipelineRenderingCreateInfo rendering_info(0, 1, &format.format);
+    // Frames go to the screen or get copied out, the frame graph leaves the image ready for that
+    graph_access target_final = headless ? graph_access::transfer_read : graph_access::present;
 
     vk::GraphicsPipelineCreateInfo pipeline_info = {};
     pipeline_info.stageCount = 2;
@@ -606,50 +663,74 @@ int main()
     pipeline_info.pVertexInputState = &vertex_input_info;
     pipeline_info.pInputAssemblyState = &input_assembly_info;
     pipeline_info.pViewportState = &viewport_info;
+    pipeline_info.pDynamicState = &dynamic_state_info;
     pipeline_info.pRasterizationState = &raster_info;
     pipeline_info.pMultisampleState = &multisampling_info;
     pipeline_info.pColorBlendState = &color_blend_info;
     pipeline_info.layout = pipeline_layout;
-    pipeline_info.renderPass = render_pass;
-    pipeline_info.subpass = 0;
+    pipeline_info.pNext = &rendering_info;
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_info.basePipelineIndex = -1;
 
-    auto pipeline_result = device.createGraphicsPipeline(VK_NULL_HANDLE, pipeline_info);
-
-    if (pipeline_result.result != vk::Result::eSuccess)
+    // --no-pipeline-cache ignores whatever is on disk so a cold start can be timed, the cache is still saved
+    pipeline_cache pipelines = create_pipeline_cache(device, selected_physical_device, "pipeline_cache.bin", !use_pipeline_cache);
+    vk::Pipeline pipeline = create_cached_graphics_pipeline(pipelines, pipeline_info);
+    cull_pass culling = create_cull_pass(device, pipelines, shaders, frames_in_flight, transforms);
+    game_sprites sprite_art = build_game_sprites();
+    sprite_renderer sprite_draws = create_sprite_renderer(device, pipelines, shaders, pipeline_layout, bindless, format.format);
+    std::println("Pipeline creation success! {} pipelines in {:.3f} ms, {} cache hits, {} misses ({} cache)",
+                pipelines.pipelines, pipelines.create_ms, pipelines.hits, pipelines.misses, pipelines.loaded ? "warm" : "cold");
+
+    // The quad mesh never changes, it lives in device local memory and is uploaded once.
+    // Every entity is this quad scaled and moved by its instance data
+    staging_uploader uploader = create_staging_uploader(device, selected_physical_device, transfer_queue, transfer_queue_index, 1024 * 1024);
+    // A level brings its own entities, it stays mapped until the simulation has copied it
+    scene_view scene{};
+    if (scene_path)
     {
-        std::println("Pipeline creation failed!");
-        return -1;
+        auto scene_start = std::chrono::steady_clock::now();
+        try
+        {
+            scene = open_scene(scene_path);
+        }
+        catch (std::exception &e)
+        {
+            std::println("Cant load scene {}: {}", scene_path, e.what());
+            return -1;
+        }
+        std::println("Scene {}: {} entities, {} meshes, mapped and validated in {:.3f} ms", scene_path, scene.header->entity_count,
+                    scene.meshes.size(), ms(std::chrono::steady_clock::now() - scene_start).count());
     }
-    vk::Pipeline pipeline = pipeline_result.value;
-    std::println("Pipeline creation success!");
-
-
-    std::vector<vk::Framebuffer> framebuffers;
-
-    for (auto &view: image_views)
+    // Instances and sprites are always the unit quad, sprite.vert takes its UVs from it and cull.comp its bounds.
+    // Scene meshes stay out of the draw path until culling knows real bounds
+    gpu_mesh unit_quad = upload_mesh(device, buffer_arena, uploader, quad_mesh(1.0f, 1.0f), static_buffer_families);
+    upload_atlas(sprite_draws, selected_physical_device, uploader, sprite_art.atlas, static_buffer_families);
+    flush_uploads(uploader);
+    std::println("Sprite atlas: {} pages of {}x{}", sprite_art.atlas.pages.size(), sprite_art.atlas.page_size, sprite_art.atlas.page_size);
+
+    // Anything loaded while the game runs goes through here, it shares the transfer queue with the uploader
+    // but only after startup, both are driven from this thread
+    asset_loader assets;
+    init_asset_loader(assets, device, selected_physical_device, transfer_queue, transfer_queue_index, buffer_arena, static_buffer_families, 2, 16 * 1024 * 1024);
+    if (asset_directory)
     {
-        vk::FramebufferCreateInfo framebuffer_info = vk::FramebufferCreateInfo(vk::FramebufferCreateFlags(),
-                                                                        render_pass, view, framebuffer_extension.width,
-                                                                        framebuffer_extension.height, 1);
-        framebuffers.push_back(device.createFramebuffer(framebuffer_info));
+        std::error_code error;
+        for (auto &entry: std::filesystem::directory_iterator(asset_directory, error))
+        {
+            std::string extension = entry.path().extension().string();
+            if (extension == ".ppm" || extension == ".pam")
+                load_texture_async(assets, entry.path().string());
+            else if (extension == ".obj")
+                load_mesh_async(assets, entry.path().string());
+        }
+        if (error)
+            std::println("Cant read asset directory {}: {}", asset_directory, error.message());
+        std::println("Loading {} assets from {} in the background", assets.slots.size(), asset_directory);
     }
-    quad play{};
-    play.box = player;
-    play.vertices = {
-        {{-0.05f, -0.1f}, {1.0f, 0.0f, 0.0f}},
-        {{0.05f, -0.1f}, {1.0f, 0.0f, 0.0f}},
-        {{0.05f, 0.1f}, {0.0f, 1.0f, 0.0f}},
-        {{-0.05f, 0.1f}, {0.0f, 0.0f, 1.0f}}
-    };
-    play.vertices = convert_quad_to_triangles(play.vertices);
-    auto ret = create_buffer(device, selected_physical_device, vk::BufferUsageFlagBits::eVertexBuffer, sizeof(vertex) * 6 * 100);
-    vk::DeviceMemory vertex_memory = ret.first;
-    vk::Buffer vertex_buffer = ret.second;
-    char *vertex_data = (char *)device.mapMemory(vertex_memory, 0, sizeof(vertex) * 6 * 100); // 100 quads
-    memcpy(vertex_data, play.vertices.data(), sizeof(play.vertices[0]) * play.vertices.size());
-    
+
+    arena_stats memory_stats = get_arena_stats(buffer_arena);
+    std::println("Buffer arena: {} bytes used of {} reserved in {} blocks, {} allocations", 
+                memory_stats.used, memory_stats.reserved, memory_stats.blocks, memory_stats.allocations);
 
     vk::CommandPoolCreateInfo command_pool_info = {};
     command_pool_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
@@ -658,232 +739,527 @@ int main()
 
     vk::CommandBufferAllocateInfo cmd_alloc_info = vk::CommandBufferAllocateInfo(command_pool, 
                                                                                 vk::CommandBufferLevel::ePrimary,
-                                                                                1);
+                                                                                frames_in_flight);
     auto command_buffers = device.allocateCommandBuffers(cmd_alloc_info);
-    vk::DescriptorPoolSize descriptor_pool_size(vk::DescriptorType::eUniformBuffer, sizeof(uniform));
+    std::array<vk::DescriptorPoolSize, 1> descriptor_pool_sizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, frames_in_flight),
+    };
     vk::DescriptorPoolCreateInfo descriptor_pool_info;
-    descriptor_pool_info.maxSets = 1;
-    descriptor_pool_info.poolSizeCount = 1;
-    descriptor_pool_info.pPoolSizes = &descriptor_pool_size;
+    descriptor_pool_info.maxSets = frames_in_flight;
+    descriptor_pool_info.poolSizeCount = descriptor_pool_sizes.size();
+    descriptor_pool_info.pPoolSizes = descriptor_pool_sizes.data();
 
     vk::DescriptorPool descriptor_pool = device.createDescriptorPool(descriptor_pool_info);
 
+    std::vector<vk::DescriptorSetLayout> descriptor_layouts(frames_in_flight, descriptor_layout);
     vk::DescriptorSetAllocateInfo descriptor_set_allocate_info;
     descriptor_set_allocate_info.descriptorPool = descriptor_pool;
-    descriptor_set_allocate_info.descriptorSetCount = 1;
-    descriptor_set_allocate_info.pSetLayouts = &descriptor_layout;
+    descriptor_set_allocate_info.descriptorSetCount = frames_in_flight;
+    descriptor_set_allocate_info.pSetLayouts = descriptor_layouts.data();
 
     auto descriptor_sets = device.allocateDescriptorSets(descriptor_set_allocate_info);
-    vk::DescriptorSet descriptor_set = descriptor_sets[0];
-
-    vk::DescriptorBufferInfo descriptor_buffer_info;
-    descriptor_buffer_info.buffer = uniform_buffer;
-    descriptor_buffer_info.offset = 0;
-    descriptor_buffer_info.range = sizeof(uniform);
-
-    vk::WriteDescriptorSet write_descriptor;
-    write_descriptor.descriptorCount = 1;
-    write_descriptor.descriptorType = vk::DescriptorType::eUniformBuffer;
-    write_descriptor.dstBinding = 0;
-    write_descriptor.dstArrayElement = 0;
-    write_descriptor.dstSet = descriptor_set;
-    write_descriptor.pBufferInfo = &descriptor_buffer_info;
-    device.updateDescriptorSets(write_descriptor, nullptr);
+
+    // Draws are recorded into secondaries by record_threads threads and executed by the frame's primary
+    command_recorder recorder;
+    init_command_recorder(recorder, device, graphics_queue_index, record_threads, frames_in_flight);
+    gpu_timer gpu_timing = create_gpu_timer(device, selected_physical_device, graphics_queue_index, frames_in_flight, 8);
 
     vk::SemaphoreCreateInfo semaphore_info = vk::SemaphoreCreateInfo();
     vk::FenceCreateInfo fence_info = vk::FenceCreateInfo();
     fence_info.flags = vk::FenceCreateFlagBits::eSignaled;
-    vk::Semaphore image_semaphore = device.createSemaphore(semaphore_info);
-    vk::Semaphore render_semaphore = device.createSemaphore(semaphore_info);
-    vk::Fence next_frame_fence = device.createFence(fence_info);
-    player.x = 0.0f;
-    player.y = 0.0f;
-    player.height = 0.2f;
-    player.width = 0.1f;
-    //velocityX = 0.008f;
+
+    std::vector<frame_data> frames(frames_in_flight);
+    for (uint32_t i = 0; i < frames_in_flight; i++)
+    {
+        frame_data &frame = frames[i];
+        frame.command_buffer = command_buffers[i];
+        frame.fence = device.createFence(fence_info);
+        frame.image_semaphore = device.createSemaphore(semaphore_info);
+        frame.descriptor_set = descriptor_sets[i];
+        // Starts with room for 1024 quads and grows on demand
+        // Only the cull shader reads it, the draw uses the compacted copy in frame.cull
+        frame.instances = create_stream_buffer(device, buffer_arena, vk::BufferUsageFlagBits::eStorageBuffer, instance_stride(transforms) * 1024);
+        frame.sprites = create_stream_buffer(device, buffer_arena, vk::BufferUsageFlagBits::eVertexBuffer, sizeof(sprite_instance) * 256);
+        // One indirect draw per recording thread so each thread gets a share of the instances
+        frame.cull = create_cull_frame(device, culling, buffer_arena, recorder.thread_count);
+        frame.transients = create_graph_memory(device, selected_physical_device);
+        frame.uniform_offset = uniform_slice_size * i;
+        frame.uniform_data = uniform_data + frame.uniform_offset;
+        frame.record_ms = 0.0;
+        frame.bytes_streamed = 0;
+        frame.submitted = false;
+
+        vk::DescriptorBufferInfo descriptor_buffer_info;
+        descriptor_buffer_info.buffer = uniform_buffer;
+        descriptor_buffer_info.offset = frame.uniform_offset;
+        descriptor_buffer_info.range = sizeof(uniform);
+
+        vk::WriteDescriptorSet write_descriptor;
+        write_descriptor.descriptorCount = 1;
+        write_descriptor.descriptorType = vk::DescriptorType::eUniformBuffer;
+        write_descriptor.dstBinding = 0;
+        write_descriptor.dstArrayElement = 0;
+        write_descriptor.dstSet = frame.descriptor_set;
+        write_descriptor.pBufferInfo = &descriptor_buffer_info;
+
+        device.updateDescriptorSets(write_descriptor, nullptr);
+        frame.instance_slot = bindless_add_buffer(bindless, frame.cull.culled_buffer);
+        frame.bound_instances = frame.cull.culled_buffer;
+    }
+    std::println("Bindless heap: {}/{} storage buffers, {}/{} images, {}/{} samplers in use after {} descriptor writes",
+                bindless_slots_in_use(bindless, bindless_kind::storage_buffer), bindless.capacity[(size_t)bindless_kind::storage_buffer],
+                bindless_slots_in_use(bindless, bindless_kind::sampled_image), bindless.capacity[(size_t)bindless_kind::sampled_image],
+                bindless_slots_in_use(bindless, bindless_kind::sampler), bindless.capacity[(size_t)bindless_kind::sampler], bindless.writes);
+    uint32_t current_frame = 0;
+    sprite_batch batch;
+    // Rebuilt every frame, only its storage carries over
+    frame_graph graph;
+    graph.alias_granularity = selected_physical_device.getProperties().limits.bufferImageGranularity;
+    // Non empty sprite ranges the last recorded frame drew, for the headless report
+    uint32_t sprite_draw_count = 0;
 
     float angle = 0.0f;
-    float vel2 = 0.005f;
-    //std::thread phy_thread(simple_physics);
-    glfwSetKeyCallback(window, keyboard_handle);
-    auto before = clock::now();
-    player.accY = 1.3f;
-    player.x = -0.8;
-    player.y = -0.5;
-    play.box = player;
-    std::vector<quad> enemies;
-    bool on_ground = true;
-    int jumps = 0;
-    int score = 0;
-    while(!glfwWindowShouldClose(window))
+    // The game ticks at a fixed rate no matter how fast we render, frames interpolate between ticks.
+    // Headless runs tick once per frame at 60hz on this thread so every benchmark simulates the same game
+    simulation sim;
+    init_simulation(sim, seed, headless ? headless_dt : 1.0f / 120.0f);
+    if (scene_path)
     {
-        glfwPollEvents();
-        std::vector<vertex> render_vertices = play.vertices;
-        auto res_wait = device.waitForFences(next_frame_fence, VK_TRUE, UINT64_MAX);
-        if (res_wait != vk::Result::eSuccess)
-            throw std::runtime_error("failed waiting!");
-        device.resetFences(next_frame_fence);
-        if (skip_rendering)
+        load_simulation_scene(sim, scene);
+        close_scene(scene);
+    }
+    if (!headless)
+    {
+        glfwSetWindowUserPointer(window, &sim);
+        glfwSetKeyCallback(window, keyboard_handle);
+        start_simulation_thread(sim);
+    }
+    std::println("Startup took {:.3f} ms", ms(std::chrono::steady_clock::now() - startup_begin).count());
+    // Secondaries only need the attachment formats of whatever they are executed in
+    vk::CommandBufferInheritanceRenderingInfo inheritance_rendering = {};
+    inheritance_rendering.colorAttachmentCount = 1;
+    inheritance_rendering.pColorAttachmentFormats = &format.format;
+    inheritance_rendering.rasterizationSamples = vk::SampleCountFlagBits::e1;
+    vk::CommandBufferInheritanceInfo inheritance = {};
+    inheritance.pNext = &inheritance_rendering;
+    if (bench_record_draws > 0)
+    {
+        // One single quad draw per item, the worst case for a scene that cant be instanced
+        draw_state bench_state = full_target_state(framebuffer_extension);
+        vk::DeviceSize vertex_offset = 0;
+        record_function record_draws = [&](vk::CommandBuffer command_buffer, uint32_t first, uint32_t count)
         {
-            continue;
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+            set_draw_state(command_buffer, bench_state);
+            command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, {frames[0].descriptor_set, bindless.set}, nullptr);
+            command_buffer.pushConstants<uint32_t>(pipeline_layout, vk::ShaderStageFlagBits::eAllGraphics, offsetof(draw_constants, instances),
+                                                    frames[0].instance_slot);
+            command_buffer.bindVertexBuffers(0, unit_quad.vertex_buffer, vertex_offset);
+            command_buffer.bindIndexBuffer(unit_quad.index_buffer, 0, unit_quad.index_type);
+            for (uint32_t i = 0; i < count; i++)
+                command_buffer.drawIndexed(unit_quad.index_count, 1, 0, 0, 0);
+        };
+        run_record_benchmark(device, graphics_queue_index, inheritance, record_draws, bench_record_draws);
+        frame_count = 0;
+    }
+    frame_stats stats;
+    stats.reserve(frame_count);
+    stats.frames_in_flight = frames_in_flight;
+    uint32_t frames_rendered = 0;
+    size_t replay_cursor = 0;
+    bool replay_overflowed = false;
+    uint64_t inputs_seen = 0;
+    std::vector<double> input_latency;
+    auto last_fence_time = std::chrono::steady_clock::now();
+    auto last_summary_time = last_fence_time;
+    while(headless ? frames_rendered < frame_count : !glfwWindowShouldClose(window))
+    {
+        if (!headless)
+        {
+            profile_zone zone("poll events");
+            glfwPollEvents();
+        }
+        frame_data &frame = frames[current_frame];
+        {
+            profile_zone zone("wait fence");
+            auto res_wait = device.waitForFences(frame.fence, VK_TRUE, UINT64_MAX);
+            if (res_wait != vk::Result::eSuccess)
+                throw std::runtime_error("failed waiting!");
         }
-        auto image_result = device.acquireNextImageKHR(swapchain, UINT64_MAX, image_semaphore);
-        if (image_result.result != vk::Result::eSuccess)
+        auto fence_time = std::chrono::steady_clock::now();
+        // The fence we just waited on belongs to the last submit that used this slot
+        if (frame.submitted)
         {
-            throw std::runtime_error("Getting next image failed!");
+            stats.add_frame(frame.record_ms, ms(fence_time - frame.submit_time).count(), ms(fence_time - last_fence_time).count(), frame.bytes_streamed);
+            collect_gpu_zones(gpu_timing, current_frame, frame.submit_time);
         }
-        uint32_t image_index = image_result.value;
-        vkResetCommandBuffer(command_buffers[0], 0);
-        if (enemies.empty())
+        if (!headless && fence_time - last_summary_time > std::chrono::seconds(5))
         {
-            quad enemy{};
-            std::mt19937 rng2(dev());
-            enemy.box = spawn_enemy(rng2);
-            enemy.vertices = bounding_box_to_vertices(enemy.box);
-            enemy.trans.transform = glm::mat4{1.0f};
-            enemies.push_back(enemy);
+            print_profile_summary();
+            last_summary_time = fence_time;
         }
-        auto time_elapsed = clock::now() - before;
-        if (pressed_space == true)
+        frame.submitted = false;
+        last_fence_time = fence_time;
+        uint32_t image_index = current_frame;
+        vk::Image target_image;
+        vk::ImageView target_view;
+        if (!headless)
         {
-            #ifndef NDEBUG
-            //std::println("JUMP!");
-            #endif
-            if (on_ground || jumps <= 1)
+            if (framebuffer_resized)
+            {
+                framebuffer_resized = false;
+                if (!recreate_window_swapchain(swapchain))
+                    break;
+                framebuffer_extension = swapchain.extent;
+            }
+            // The fence is only reset once we know this frame will be submitted, otherwise the next wait on it never returns
+            try
             {
-                if (jumps <= 1)
-                    play.box.velocityY = -1.2f;
-                on_ground = false;
-                jumps++;
-                std::println("Jumps {}", jumps);
+                profile_zone zone("acquire");
+                auto image_result = device.acquireNextImageKHR(swapchain.handle, UINT64_MAX, frame.image_semaphore);
+                image_index = image_result.value;
+                // Still presentable, render this one and rebuild right after
+                if (image_result.result == vk::Result::eSuboptimalKHR)
+                    framebuffer_resized = true;
             }
-            pressed_space = false;
-        }
-        if (pressed_shift == true)
-        {
-            play.box.velocityY = 3.0f;
-            pressed_shift = false;
-        }
-        bool end_game = false;
-        if (stop_physics == false)
-            end_game = simple_physics_step(std::chrono::duration_cast<std::chrono::duration<float>>(time_elapsed).count(), play.box, enemies, on_ground);
-        if (on_ground)
-            jumps = 0;
-        if (end_game == true)
-        {
-            std::println("You lost!");
-            std::println("Your score was {}", score);
-            stop_physics = true;
-            #ifndef NDEBUG
-            std::println("Collision between pos x: {} y: {} and pos x: {} and pos y: {} ", play.box.x, play.box.y, enemies[0].box.x, enemies[0].box.y);
-            std::println("With width: {} and height: {} and width: {} and height: {}", play.box.width, play.box.height, enemies[0].box.width, enemies[0].box.height);
-            std::println("Rightmost vertex in position {} collided with leftmost vertex in position {}", play.box.x + play.box.width/2, enemies[0].box.x - enemies[0].box.width/2);
-            std::println("Jumps {}", jumps);
-            #endif
-        }
-        before = clock::now();
-        play.trans.transform = move({play.box.x, play.box.y});
-        for (auto &e: enemies)
-        {
-            if (e.box.x + e.box.width/2 <= -1.0f)
+            catch (vk::OutOfDateKHRError &)
+            {
+                framebuffer_resized = true;
+                continue;
+            }
+            target_image = swapchain.images[image_index];
+            target_view = swapchain.views[image_index];
+        }
+        else
+        {
+            target_image = images[image_index];
+            target_view = image_views[image_index];
+        }
+        device.resetFences(frame.fence);
+        frame.command_buffer.reset();
+        reset_graph_memory(frame.transients);
+        bindless_retire_frees(bindless, current_frame);
+        update_asset_loader(assets);
+        if (headless)
+        {
+            profile_zone zone("simulation");
+            // The recorded inputs go through the same queue the keyboard uses, in the tick they happened in
+            auto now = std::chrono::steady_clock::now();
+            // The queue is drained every tick, so a recording never queued more in one tick than it holds.
+            // If this one does, a later tick would change the outcome, so the replay fails instead
+            while (!replay_overflowed && replay_cursor < replay.events.size() && replay.events[replay_cursor].tick <= sim.tick + 1)
             {
-                score += (int)(abs((e.box.width * 10)) + abs((e.box.height * 10)) + abs((e.box.velocityX * 10)));
-                enemies.clear();
-                break;
+                if (!sim.input.push({now, replay.events[replay_cursor].action}))
+                {
+                    std::println("Replay has more inputs in tick {} than the input queue holds", sim.tick + 1);
+                    replay_overflowed = true;
+                    break;
+                }
+                replay_cursor++;
             }
-            e.trans.transform = move({e.box.x, e.box.y});
-            add_quad_to_vertices(render_vertices, e.vertices);
+            simulation_tick(sim);
+            publish_snapshot(sim, std::chrono::steady_clock::now());
+        }
+        sim.snapshots.acquire();
+        const sim_snapshot &snapshot = sim.snapshots.read_slot();
+        float alpha = headless ? 1.0f : snapshot_alpha(snapshot, sim.dt, std::chrono::steady_clock::now());
+        // This frame is the first to show the newest input, its submit closes the input latency sample
+        bool shows_new_input = snapshot.inputs_applied > inputs_seen;
+        inputs_seen = snapshot.inputs_applied;
+        auto input_time = snapshot.last_input_time;
+        // Instance 0 is the player, enemies follow
+        profile_zone upload_zone("instance upload");
+        stream_begin(frame.instances);
+        const entity_store &enemies = snapshot.enemies;
+        uint32_t instance_count = 1 + enemies.size();
+        vk::DeviceSize instance_offset = 0;
+        uint32_t stride = instance_stride(transforms);
+        char *instances = (char *)stream_alloc<float>(frame.instances, instance_count * stride / sizeof(float), instance_offset);
+        const bounding_box &player = snapshot.player;
+        glm::vec2 player_position = glm::mix(snapshot.player_previous, glm::vec2(player.x, player.y), alpha);
+        write_quad_instance(instances, transforms, player_position, {player.width, player.height}, {1.0f, 1.0f, 1.0f});
+        for (size_t i = 0; i < enemies.size(); i++)
+        {
+            glm::vec2 position = {enemies.x[i], enemies.y[i]};
+            if (i < snapshot.enemies_previous.size())
+                position = glm::mix(snapshot.enemies_previous[i], position, alpha);
+            write_quad_instance(instances + (i + 1) * stride, transforms, position, {enemies.width[i], enemies.height[i]}, enemies.color[i]);
         }
+        // Textured stuff goes through the sprite batch, the face on the player and the score on top of everything
+        stream_begin(frame.sprites);
+        sprite_batch_begin(batch);
+        push_sprite(batch, {player_position, {player.width, player.height}, sprite_art.face, glm::vec4(1.0f), 0});
+        std::string score = std::to_string(std::max(snapshot.score, 0));
+        glm::vec2 digit_size = {0.04f, 0.072f};
+        for (size_t i = 0; i < score.size(); i++)
+        {
+            glm::vec2 position = {-0.95f + digit_size.x * 0.5f + i * digit_size.x * 1.25f, -0.9f};
+            push_sprite(batch, {position, digit_size, sprite_art.digits[score[i] - '0'], glm::vec4(1.0f, 0.9f, 0.2f, 1.0f), 1});
+        }
+        build_sprite_batch(batch, frame.sprites, sprite_draws.page_textures);
+        upload_zone.end();
         //memcpy(uniform_data, &u, sizeof(uniform));
 
         angle -= 0.01f;
-        memcpy(vertex_data, render_vertices.data(), sizeof(render_vertices[0]) * render_vertices.size());
 
 
         vk::CommandBufferBeginInfo begin_info = {};
+        begin_info.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
         vk::ClearValue clear_color = vk::ClearValue({0.0f, 0.0f, 0.0f, 1.0f});
-        vk::Rect2D render_area = {{0, 0}, framebuffer_extension};
-        vk::RenderPassBeginInfo render_pass_begin = vk::RenderPassBeginInfo(render_pass, framebuffers[image_index],
-                                                                            render_area, 1, &clear_color);
-        vk::DeviceSize offset = 0;
-        command_buffers[0].begin(begin_info);
-        command_buffers[0].beginRenderPass(render_pass_begin, vk::SubpassContents::eInline);
-        command_buffers[0].bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
-        //command_buffers[0].setViewport(0, viewport);
-        //command_buffers[0].setScissor(0, scissor);
-        command_buffers[0].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, descriptor_sets, nullptr);
-        command_buffers[0].bindVertexBuffers(0, 1, &vertex_buffer, &offset);
-        command_buffers[0].pushConstants(pipeline_layout, vk::ShaderStageFlags(vk::ShaderStageFlagBits::eVertex), 0, sizeof(push), &play.trans);
-        command_buffers[0].draw(6, 1, 0, 0);
-        uint32_t offset_vertex = 6;
-        for (auto &e: enemies)
-        {
-            command_buffers[0].pushConstants(pipeline_layout, vk::ShaderStageFlags(vk::ShaderStageFlagBits::eVertex), 0, sizeof(push), &e.trans);
-            command_buffers[0].draw(6, 1, offset_vertex, 0);
-            offset_vertex += 6;
-        }
-
-        command_buffers[0].endRenderPass();
-        if (vkEndCommandBuffer(command_buffers[0]) != VK_SUCCESS)
+        auto record_start = std::chrono::steady_clock::now();
+        profile_zone record_zone("record");
+        // Culling can grow the culled buffer, the slot still points at the old one then. No pending
+        // frame reads this slot, so it can be rewritten while the heap is bound in the others
+        prepare_cull(culling, frame.cull, buffer_arena, instance_count, unit_quad.index_count);
+        if (frame.bound_instances != frame.cull.culled_buffer)
+        {
+            bindless_write_buffer(bindless, frame.instance_slot, frame.cull.culled_buffer);
+            frame.bound_instances = frame.cull.culled_buffer;
+        }
+        vk::DeviceSize vertex_offset = 0;
+        draw_state frame_state = full_target_state(framebuffer_extension);
+        // Items are the cull frame's indirect draws, then the sprites cut into as many ranges, so every
+        // recording thread gets work. Items come in order, so the draw order doesnt change with the thread count.
+        // State isnt inherited so each secondary binds it all again
+        uint32_t draw_slices = frame.cull.draw_count;
+        uint32_t sprite_count = (uint32_t)batch.sprites.size();
+        uint32_t sprites_per_slice = (sprite_count + draw_slices - 1) / draw_slices;
+        sprite_draw_count = sprite_count ? (sprite_count + sprites_per_slice - 1) / sprites_per_slice : 0;
+        record_function record_draws = [&](vk::CommandBuffer command_buffer, uint32_t first, uint32_t count)
+        {
+            // Both pipelines share the layout, so the sets go first whatever items this secondary got
+            command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, {frame.descriptor_set, bindless.set}, nullptr);
+            bool instances_bound = false;
+            for (uint32_t item = first; item < first + count; item++)
+            {
+                if (item >= draw_slices)
+                {
+                    uint32_t first_sprite = std::min((item - draw_slices) * sprites_per_slice, sprite_count);
+                    record_sprites(command_buffer, sprite_draws, batch, frame.sprites, unit_quad, frame_state,
+                                   first_sprite, std::min(sprites_per_slice, sprite_count - first_sprite));
+                    continue;
+                }
+                if (!instances_bound)
+                {
+                    command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+                    set_draw_state(command_buffer, frame_state);
+                    command_buffer.pushConstants<uint32_t>(pipeline_layout, vk::ShaderStageFlagBits::eAllGraphics, offsetof(draw_constants, instances),
+                                                            frame.instance_slot);
+                    command_buffer.bindVertexBuffers(0, unit_quad.vertex_buffer, vertex_offset);
+                    command_buffer.bindIndexBuffer(unit_quad.index_buffer, 0, unit_quad.index_type);
+                    instances_bound = true;
+                }
+                command_buffer.drawIndexedIndirect(frame.cull.indirect_buffer, item * sizeof(vk::DrawIndexedIndirectCommand), 1,
+                                                   sizeof(vk::DrawIndexedIndirectCommand));
+            }
+        };
+        auto secondaries = record_secondaries(recorder, current_frame, inheritance, draw_slices * 2, record_draws);
+
+        // The CPU filled the streams before submit, so they need no barriers. Everything between the
+        // passes and the move to present or transfer comes out of compile_graph
+        begin_graph(graph);
+        graph_handle instance_stream = import_buffer(graph, "instances", frame.instances.buffer, graph_access::none, graph_access::none);
+        graph_handle sprite_stream = import_buffer(graph, "sprites", frame.sprites.buffer, graph_access::none, graph_access::none);
+        graph_handle culled = import_buffer(graph, "culled instances", frame.cull.culled_buffer, graph_access::none, graph_access::none);
+        // The headless report reads the culled instance count back out of the indirect draws
+        graph_handle indirect = import_buffer(graph, "indirect draw", frame.cull.indirect_buffer, graph_access::none, graph_access::host_read);
+        graph_handle target = import_image(graph, "target", target_image, target_view, graph_access::acquired, target_final);
+        graph_handle cull_groups = create_graph_buffer(graph, "cull groups", cull_group_buffer_size(instance_count));
+        add_graph_pass(graph, "cull", {{instance_stream, graph_access::compute_read}, {culled, graph_access::compute_write},
+                                       {indirect, graph_access::compute_write}, {cull_groups, graph_access::compute_write}},
+                       [&](vk::CommandBuffer command_buffer)
+                       {
+                           uint32_t zone = gpu_zone_begin(gpu_timing, command_buffer, current_frame, "gpu cull");
+                           record_cull(command_buffer, culling, frame.cull, frame.instances, instance_offset, instance_count,
+                                       graph.resources[cull_groups].buffer, view_min, view_max);
+                           gpu_zone_end(gpu_timing, command_buffer, current_frame, zone);
+                       });
+        add_graph_pass(graph, "draw", {{culled, graph_access::vertex_read}, {indirect, graph_access::indirect_read},
+                                       {sprite_stream, graph_access::vertex_input}, {target, graph_access::color_write}},
+                       [&](vk::CommandBuffer command_buffer)
+                       {
+                           // Timestamps cant go inside rendering that only executes secondaries, so the zone wraps all of it
+                           uint32_t zone = gpu_zone_begin(gpu_timing, command_buffer, current_frame, "gpu draw");
+                           begin_color_rendering(command_buffer, target_view, framebuffer_extension, clear_color,
+                                               vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+                           command_buffer.executeCommands(secondaries);
+                           command_buffer.endRendering();
+                           gpu_zone_end(gpu_timing, command_buffer, current_frame, zone);
+                       });
+        compile_graph(graph, graph_memory_requirements(frame.transients));
+        bind_graph_memory(graph, frame.transients);
+
+        frame.command_buffer.begin(begin_info);
+        gpu_timer_begin_frame(gpu_timing, frame.command_buffer, current_frame);
+        execute_graph(graph, frame.command_buffer);
+        if (vkEndCommandBuffer(frame.command_buffer) != VK_SUCCESS)
         {
             throw std::runtime_error("Command buffer creation failed!");
         }
+        auto record_end = std::chrono::steady_clock::now();
+        record_zone.end();
 
         vk::PipelineStageFlags flags(vk::PipelineStageFlagBits::eColorAttachmentOutput);
         vk::SubmitInfo submit_info = vk::SubmitInfo();
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = &image_semaphore;
-        submit_info.pWaitDstStageMask = &flags;
-        submit_info.signalSemaphoreCount = 1;
-        submit_info.pSignalSemaphores = &render_semaphore;
+        if (!headless)
+        {
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &frame.image_semaphore;
+            submit_info.pWaitDstStageMask = &flags;
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &swapchain.render_semaphores[image_index];
+        }
         submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &command_buffers[0];
+        submit_info.pCommandBuffers = &frame.command_buffer;
 
-        graphics_queue.submit(submit_info, next_frame_fence);
+        frame.record_ms = ms(record_end - record_start).count();
+        frame.bytes_streamed = frame.instances.bytes_written + frame.sprites.bytes_written;
+        frame.submit_time = std::chrono::steady_clock::now();
+        {
+            profile_zone zone("submit");
+            graphics_queue.submit(submit_info, frame.fence);
+        }
+        frame.submitted = true;
+        if (shows_new_input)
+            input_latency.push_back(ms(frame.submit_time - input_time).count());
+        frames_rendered++;
+        current_frame = (current_frame + 1) % frames_in_flight;
+        if (headless)
+            continue;
 
         vk::PresentInfoKHR present_info = {};
         present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores = &render_semaphore;
+        present_info.pWaitSemaphores = &swapchain.render_semaphores[image_index];
         present_info.swapchainCount = 1;
-        present_info.pSwapchains = &swapchain;
+        present_info.pSwapchains = &swapchain.handle;
         present_info.pImageIndices = &image_index;
 
-        auto present_result = graphics_queue.presentKHR(present_info);
-        if (present_result != vk::Result::eSuccess)
-            throw std::runtime_error("Presenting to the graphics queue failed");
+        try
+        {
+            profile_zone zone("present");
+            if (graphics_queue.presentKHR(present_info) == vk::Result::eSuboptimalKHR)
+                framebuffer_resized = true;
+        }
+        catch (vk::OutOfDateKHRError &)
+        {
+            framebuffer_resized = true;
+        }
+    }
+    // Collect the frames still in flight, oldest first
+    for (uint32_t i = 0; headless && i < frames_in_flight; i++)
+    {
+        frame_data &frame = frames[(current_frame + i) % frames_in_flight];
+        if (!frame.submitted)
+            continue;
+        auto res_wait = device.waitForFences(frame.fence, VK_TRUE, UINT64_MAX);
+        if (res_wait != vk::Result::eSuccess)
+            throw std::runtime_error("failed waiting!");
+        auto fence_time = std::chrono::steady_clock::now();
+        stats.add_frame(frame.record_ms, ms(fence_time - frame.submit_time).count(), ms(fence_time - last_fence_time).count(), frame.bytes_streamed);
+        collect_gpu_zones(gpu_timing, (current_frame + i) % frames_in_flight, frame.submit_time);
+        last_fence_time = fence_time;
+    }
+    if (headless && bench_record_draws == 0)
+    {
+        stats.report();
+        const frame_data &last_frame = frames[(current_frame + frames_in_flight - 1) % frames_in_flight];
+        if (last_frame.submitted)
+            std::println("Last frame drew {} instances after culling", culled_instance_count(last_frame.cull));
+        std::println("Last frame drew {} sprites in {} draws", batch.sprites.size(), sprite_draw_count);
+        print_graph(graph);
+        if (asset_directory)
+        {
+            uint32_t ready = 0, failed = 0;
+            double total_ms = 0.0, max_ms = 0.0;
+            for (auto &slot: assets.slots)
+            {
+                if (slot.state == asset_state::failed)
+                    failed++;
+                if (slot.state != asset_state::ready)
+                    continue;
+                ready++;
+                total_ms += slot.load_ms;
+                max_ms = std::max(max_ms, slot.load_ms);
+            }
+            std::println("Assets: {} ready, {} failed, {} still loading, request to ready avg {:.3f} ms max {:.3f} ms",
+                        ready, failed, assets.slots.size() - ready - failed, ready ? total_ms / ready : 0.0, max_ms);
+        }
+        print_profile_summary();
+    }
+    if (!input_latency.empty())
+    {
+        double max_latency = *std::max_element(input_latency.begin(), input_latency.end());
+        std::println("Input to submit latency over {} inputs: p50 {:.3f} ms, p95 {:.3f} ms, max {:.3f} ms",
+                    input_latency.size(), percentile(input_latency, 50.0), percentile(input_latency, 95.0), max_latency);
+    }
+    if (trace_path)
+        write_chrome_trace(trace_path);
+    stop_simulation_thread(sim);
+    if (record_input_path)
+    {
+        input_recording recording{seed, sim.dt, sim.tick, sim.score, simulation_checksum(sim), sim.recorded_inputs};
+        if (save_input_recording(record_input_path, recording))
+            std::println("Recorded {} inputs over {} ticks to {}", recording.events.size(), recording.ticks, record_input_path);
+        else
+            std::println("Couldnt write the input recording to {}", record_input_path);
+    }
+    // A diverged replay fails the process, so replays work as a regression check
+    int exit_code = 0;
+    if (replay_input_path)
+    {
+        bool same = !replay_overflowed && sim.tick == replay.ticks && sim.score == replay.score && simulation_checksum(sim) == replay.checksum;
+        std::println(same ? "Replay matches the recording (score {})" : "Replay DIVERGED from the recording (score {})", sim.score);
+        if (!same)
+            exit_code = 1;
     }
-    thread = false;
-    //phy_thread.join();
-    device.unmapMemory(uniform_buffer_data);
-    device.unmapMemory(vertex_memory);
     device.waitIdle();
+    destroy_asset_loader(assets);
     device.destroyDescriptorPool(descriptor_pool);
     device.destroyDescriptorSetLayout(descriptor_layout);
-    device.destroyBuffer(vertex_buffer);
+    destroy_gpu_mesh(device, buffer_arena, unit_quad);
+    destroy_staging_uploader(uploader);
     device.destroyBuffer(uniform_buffer);
-    device.freeMemory(vertex_memory);
-    device.freeMemory(uniform_buffer_data);
-    for (auto &framebuffer: framebuffers)
+    arena_free(buffer_arena, uniform_allocation);
+    for (auto &frame: frames)
     {
-        device.destroyFramebuffer(framebuffer);
+        destroy_stream_buffer(frame.instances);
+        destroy_stream_buffer(frame.sprites);
+        destroy_cull_frame(device, buffer_arena, frame.cull);
+        destroy_graph_memory(frame.transients);
+        device.destroyFence(frame.fence);
+        device.destroySemaphore(frame.image_semaphore);
     }
-    device.destroyFence(next_frame_fence);
-    device.destroySemaphore(render_semaphore);
-    device.destroySemaphore(image_semaphore);
+    destroy_memory_arena(buffer_arena);
+    destroy_command_recorder(recorder);
+    destroy_gpu_timer(gpu_timing);
+    destroy_cull_pass(culling);
+    destroy_sprite_renderer(sprite_draws, current_frame);
+    destroy_bindless_heap(bindless);
     device.destroyCommandPool(command_pool);
     device.destroyPipeline(pipeline);
-    device.destroyRenderPass(render_pass);
+    save_pipeline_cache(pipelines, selected_physical_device);
+    destroy_pipeline_cache(pipelines);
     device.destroyPipelineLayout(pipeline_layout);
-    device.destroyShaderModule(vertex_module);
-    device.destroyShaderModule(fragment_module);
+    destroy_shader_registry(shaders);
     for (auto &image: image_views)
     {
         device.destroyImageView(image);
     }
-    device.destroySwapchainKHR(swapchain);
-    instance.destroySurfaceKHR(surface);
+    if (headless)
+    {
+        for (auto &image: images)
+            device.destroyImage(image);
+        for (auto &memory: offscreen_memory)
+            device.freeMemory(memory);
+    }
+    else
+    {
+        destroy_window_swapchain(swapchain);
+        instance.destroySurfaceKHR(surface);
+    }
     device.destroy();
     instance.destroy();
-    glfwTerminate();
-    return 0;
+    if (!headless)
+        glfwTerminate();
+    return exit_code;
 }
@@ -0,0 +1,59 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file map_file(const std::string &path)
+{
+    mapped_file file{};
+#ifdef _WIN32
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        throw std::runtime_error("cant open the file");
+    file.contents.resize((size_t)stream.tellg());
+    stream.seekg(0);
+    stream.read(file.contents.data(), file.contents.size());
+    file.data = file.contents.data();
+    file.size = file.contents.size();
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("cant open the file");
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        close(fd);
+        throw std::runtime_error("cant stat the file");
+    }
+    file.size = info.st_size;
+    if (file.size > 0)
+    {
+        void *mapping = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("cant map the file");
+        }
+        madvise(mapping, file.size, MADV_SEQUENTIAL);
+        file.data = (const char *)mapping;
+    }
+    // The mapping keeps the file alive on its own
+    close(fd);
+#endif
+    return file;
+}
+
+void unmap_file(mapped_file &file)
+{
+#ifndef _WIN32
+    if (file.data)
+        munmap((void *)file.data, file.size);
+#endif
+    file = mapped_file{};
+}
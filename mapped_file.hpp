@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read only view of a whole file. Mapped where we can, so reading it goes straight to the page cache
+// and nothing is copied until it is touched
+struct mapped_file
+{
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    std::vector<char> contents;
+#endif
+};
+
+// Throws if the file cant be opened or mapped
+mapped_file map_file(const std::string &path);
+void unmap_file(mapped_file &file);
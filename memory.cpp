@@ -0,0 +1,218 @@
+#include "memory.hpp"
+#include <cstring>
+#include <stdexcept>
+
+int find_memory_type(const vk::PhysicalDeviceMemoryProperties &memory_properties, uint32_t type_bits,
+                    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred)
+{
+    int fallback = -1;
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+    {
+        if ((type_bits & (1u << i)) == 0)
+            continue;
+        vk::MemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+        if ((flags & required) != required)
+            continue;
+        if ((flags & preferred) == preferred)
+            return i;
+        if (fallback == -1)
+            fallback = i;
+    }
+    return fallback;
+}
+
+static vk::Buffer make_buffer(const vk::Device &device, vk::BufferUsageFlags usage, size_t size, const std::vector<uint32_t> &queue_families)
+{
+    vk::BufferCreateInfo buffer_info = vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage, vk::SharingMode::eExclusive);
+    if (queue_families.size() > 1)
+    {
+        buffer_info.sharingMode = vk::SharingMode::eConcurrent;
+        buffer_info.queueFamilyIndexCount = queue_families.size();
+        buffer_info.pQueueFamilyIndices = queue_families.data();
+    }
+    return device.createBuffer(buffer_info);
+}
+
+std::pair<vk::DeviceMemory, vk::Buffer> create_buffer(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::BufferUsageFlags usage, size_t size,
+                                                    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred, const std::vector<uint32_t> &queue_families)
+{
+    vk::Buffer buffer = make_buffer(device, usage, size, queue_families);
+    vk::MemoryRequirements memory_requirements = device.getBufferMemoryRequirements(buffer);
+    vk::PhysicalDeviceMemoryProperties memory_properties = selected_physical_device.getMemoryProperties();
+
+    int propierty_index = find_memory_type(memory_properties, memory_requirements.memoryTypeBits, required, preferred);
+    if (propierty_index == -1)
+    {
+        device.destroyBuffer(buffer);
+        throw std::runtime_error("Didnt find a suitable memory");
+    }
+
+    vk::MemoryAllocateInfo alloc_info = vk::MemoryAllocateInfo(memory_requirements.size, propierty_index);
+
+    vk::DeviceMemory buffer_memory = device.allocateMemory(alloc_info);
+    device.bindBufferMemory(buffer, buffer_memory, 0);
+    return std::make_pair(buffer_memory, buffer);
+}
+
+memory_arena create_device_arena(const vk::Device &device, vk::PhysicalDevice selected_physical_device, arena_strategy strategy, vk::DeviceSize block_size)
+{
+    memory_arena arena = create_memory_arena(selected_physical_device.getMemoryProperties(), strategy, block_size);
+    arena.allocate_block = [device](uint32_t memory_type, vk::DeviceSize size) {
+        return device.allocateMemory(vk::MemoryAllocateInfo(size, memory_type));
+    };
+    arena.free_block = [device](vk::DeviceMemory memory) {
+        device.freeMemory(memory);
+    };
+    arena.map_block = [device](vk::DeviceMemory memory, vk::DeviceSize size) {
+        return (char *)device.mapMemory(memory, 0, size);
+    };
+    return arena;
+}
+
+std::pair<arena_allocation, vk::Buffer> create_arena_buffer(const vk::Device &device, memory_arena &arena, vk::BufferUsageFlags usage, size_t size,
+                                                            vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred, const std::vector<uint32_t> &queue_families)
+{
+    vk::Buffer buffer = make_buffer(device, usage, size, queue_families);
+    vk::MemoryRequirements memory_requirements = device.getBufferMemoryRequirements(buffer);
+    arena_allocation allocation;
+    try
+    {
+        allocation = arena_allocate(arena, memory_requirements, required, preferred);
+    }
+    catch (...)
+    {
+        device.destroyBuffer(buffer);
+        throw;
+    }
+    device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+    return std::make_pair(allocation, buffer);
+}
+
+staging_uploader create_staging_uploader(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::Queue queue, uint32_t queue_family, vk::DeviceSize capacity)
+{
+    staging_uploader uploader{};
+    uploader.device = device;
+    uploader.queue = queue;
+    uploader.capacity = capacity;
+
+    vk::CommandPoolCreateInfo command_pool_info = {};
+    command_pool_info.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    command_pool_info.queueFamilyIndex = queue_family;
+    uploader.command_pool = device.createCommandPool(command_pool_info);
+
+    vk::CommandBufferAllocateInfo cmd_alloc_info = vk::CommandBufferAllocateInfo(uploader.command_pool, vk::CommandBufferLevel::ePrimary, 1);
+    uploader.command_buffer = device.allocateCommandBuffers(cmd_alloc_info)[0];
+    uploader.fence = device.createFence(vk::FenceCreateInfo());
+
+    auto staging = create_buffer(device, selected_physical_device, vk::BufferUsageFlagBits::eTransferSrc, capacity);
+    uploader.staging_memory = staging.first;
+    uploader.staging_buffer = staging.second;
+    uploader.staging_data = (char *)device.mapMemory(uploader.staging_memory, 0, capacity);
+    return uploader;
+}
+
+void stage_upload(staging_uploader &uploader, vk::Buffer dst, const void *data, vk::DeviceSize size, vk::DeviceSize dst_offset)
+{
+    if (size > uploader.capacity)
+        throw std::runtime_error("Upload is bigger than the staging buffer");
+    if (uploader.used + size > uploader.capacity)
+        flush_uploads(uploader);
+
+    memcpy(uploader.staging_data + uploader.used, data, size);
+    uploader.copies.push_back({dst, vk::BufferCopy(uploader.used, dst_offset, size)});
+    // Keep every copy source 16 byte aligned, its the largest alignment copyBuffer cares about
+    uploader.used = (uploader.used + size + 15) & ~(vk::DeviceSize)15;
+    uploader.used = std::min(uploader.used, uploader.capacity);
+}
+
+void stage_image_upload(staging_uploader &uploader, vk::Image dst, const void *data, vk::DeviceSize size, vk::Extent3D extent, uint32_t layer)
+{
+    if (size > uploader.capacity)
+        throw std::runtime_error("Image upload is bigger than the staging buffer");
+    if (uploader.used + size > uploader.capacity)
+        flush_uploads(uploader);
+
+    memcpy(uploader.staging_data + uploader.used, data, size);
+    vk::BufferImageCopy region = {};
+    region.bufferOffset = uploader.used;
+    region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, layer, 1);
+    region.imageExtent = extent;
+    uploader.image_copies.push_back({dst, region});
+    uploader.used = (uploader.used + size + 15) & ~(vk::DeviceSize)15;
+    uploader.used = std::min(uploader.used, uploader.capacity);
+}
+
+// Moves every layer that gets a copy between layouts, images only ever get whole layer uploads so the old contents can go
+static void transition_upload_images(staging_uploader &uploader, vk::ImageLayout old_layout, vk::ImageLayout new_layout,
+                                    vk::AccessFlags src_access, vk::AccessFlags dst_access, vk::PipelineStageFlags src_stage, vk::PipelineStageFlags dst_stage)
+{
+    std::vector<vk::ImageMemoryBarrier> barriers;
+    for (auto &copy: uploader.image_copies)
+    {
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.first;
+        barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, copy.second.imageSubresource.baseArrayLayer, 1);
+        barriers.push_back(barrier);
+    }
+    uploader.command_buffer.pipelineBarrier(src_stage, dst_stage, {}, nullptr, nullptr, barriers);
+}
+
+void flush_uploads(staging_uploader &uploader)
+{
+    if (uploader.copies.empty() && uploader.image_copies.empty())
+        return;
+
+    vk::CommandBufferBeginInfo begin_info = vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    uploader.command_buffer.begin(begin_info);
+    // Copies into the same buffer go out as one copyBuffer with several regions
+    std::vector<vk::BufferCopy> regions;
+    for (size_t i = 0; i < uploader.copies.size(); i++)
+    {
+        regions.push_back(uploader.copies[i].second);
+        if (i + 1 == uploader.copies.size() || uploader.copies[i + 1].first != uploader.copies[i].first)
+        {
+            uploader.command_buffer.copyBuffer(uploader.staging_buffer, uploader.copies[i].first, regions);
+            regions.clear();
+        }
+    }
+    if (!uploader.image_copies.empty())
+    {
+        transition_upload_images(uploader, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                                vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+        for (auto &copy: uploader.image_copies)
+            uploader.command_buffer.copyBufferToImage(uploader.staging_buffer, copy.first, vk::ImageLayout::eTransferDstOptimal, copy.second);
+        // The uploader may be on a transfer only queue that has no shader stages, the fence wait covers the rest
+        transition_upload_images(uploader, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, {},
+                                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe);
+    }
+    uploader.command_buffer.end();
+
+    vk::SubmitInfo submit_info = vk::SubmitInfo();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &uploader.command_buffer;
+    uploader.queue.submit(submit_info, uploader.fence);
+    auto res_wait = uploader.device.waitForFences(uploader.fence, VK_TRUE, UINT64_MAX);
+    if (res_wait != vk::Result::eSuccess)
+        throw std::runtime_error("failed waiting for the uploads!");
+    uploader.device.resetFences(uploader.fence);
+    uploader.command_buffer.reset();
+
+    uploader.copies.clear();
+    uploader.image_copies.clear();
+    uploader.used = 0;
+}
+
+void destroy_staging_uploader(staging_uploader &uploader)
+{
+    uploader.device.unmapMemory(uploader.staging_memory);
+    uploader.device.destroyBuffer(uploader.staging_buffer);
+    uploader.device.freeMemory(uploader.staging_memory);
+    uploader.device.destroyFence(uploader.fence);
+    uploader.device.destroyCommandPool(uploader.command_pool);
+}
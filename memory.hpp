@@ -0,0 +1,47 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <utility>
+#include "arena.hpp"
+
+// Returns the index of the first memory type allowed by type_bits that has every required flag,
+// preferring one that also has the preferred flags. -1 if nothing matches
+int find_memory_type(const vk::PhysicalDeviceMemoryProperties &memory_properties, uint32_t type_bits,
+                    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {});
+
+// queue_families lists every family that touches the buffer, more than one makes it concurrent
+std::pair<vk::DeviceMemory, vk::Buffer> create_buffer(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::BufferUsageFlags usage, size_t size,
+                                                    vk::MemoryPropertyFlags required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                    vk::MemoryPropertyFlags preferred = {}, const std::vector<uint32_t> &queue_families = {});
+
+// Arena whose blocks are real device allocations, host visible blocks stay mapped for their whole life
+memory_arena create_device_arena(const vk::Device &device, vk::PhysicalDevice selected_physical_device, arena_strategy strategy, vk::DeviceSize block_size);
+std::pair<arena_allocation, vk::Buffer> create_arena_buffer(const vk::Device &device, memory_arena &arena, vk::BufferUsageFlags usage, size_t size,
+                                                            vk::MemoryPropertyFlags required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                            vk::MemoryPropertyFlags preferred = {}, const std::vector<uint32_t> &queue_families = {});
+
+// Copies data into device local buffers through a host visible staging buffer.
+// Uploads are queued and recorded into a single command buffer when flushed
+struct staging_uploader
+{
+    vk::Device device;
+    vk::Queue queue;
+    vk::CommandPool command_pool;
+    vk::CommandBuffer command_buffer;
+    vk::Fence fence;
+    vk::Buffer staging_buffer;
+    vk::DeviceMemory staging_memory;
+    char *staging_data;
+    vk::DeviceSize capacity;
+    vk::DeviceSize used;
+    std::vector<std::pair<vk::Buffer, vk::BufferCopy>> copies;
+    std::vector<std::pair<vk::Image, vk::BufferImageCopy>> image_copies;
+};
+
+staging_uploader create_staging_uploader(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::Queue queue, uint32_t queue_family, vk::DeviceSize capacity);
+void stage_upload(staging_uploader &uploader, vk::Buffer dst, const void *data, vk::DeviceSize size, vk::DeviceSize dst_offset = 0);
+// Fills one layer of a color image with tightly packed texels. The image has to be made with eTransferDst usage,
+// shared with the uploader's queue family, and ends up in eShaderReadOnlyOptimal once flushed
+void stage_image_upload(staging_uploader &uploader, vk::Image dst, const void *data, vk::DeviceSize size, vk::Extent3D extent, uint32_t layer = 0);
+void flush_uploads(staging_uploader &uploader);
+void destroy_staging_uploader(staging_uploader &uploader);
@@ -0,0 +1,77 @@
+#include "mesh.hpp"
+
+void write_quad_instance(char *dst, transform_format format, glm::vec2 position, glm::vec2 size, glm::vec3 color)
+{
+    if (format == transform_format::matrix)
+    {
+        matrix_instance *m = (matrix_instance *)dst;
+        m->transform = glm::mat4(1.0f);
+        m->transform[0][0] = size.x;
+        m->transform[1][1] = size.y;
+        m->transform[3] = glm::vec4(position, 0.0f, 1.0f);
+        m->color = color;
+    }
+    else
+    {
+        affine_instance *a = (affine_instance *)dst;
+        a->linear = {size.x, 0.0f, 0.0f, size.y};
+        a->translation = position;
+        a->color = color;
+    }
+}
+
+mesh quad_mesh(float width, float height)
+{
+    float half_width = width/2;
+    float half_height = height/2;
+    mesh m;
+    m.vertices = {
+        {{-half_width, -half_height}, {1.0f, 0.0f, 0.0f}},
+        {{half_width, -half_height}, {1.0f, 0.0f, 0.0f}},
+        {{half_width, half_height}, {0.0f, 1.0f, 0.0f}},
+        {{-half_width, half_height}, {0.0f, 0.0f, 1.0f}}
+    };
+    m.indices = {0, 1, 2, 0, 2, 3};
+    return m;
+}
+
+gpu_mesh upload_mesh(const vk::Device &device, memory_arena &arena, staging_uploader &uploader, const mesh &m, const std::vector<uint32_t> &queue_families)
+{
+    gpu_mesh ret{};
+    ret.index_count = m.indices.size();
+
+    auto vertex_ret = create_arena_buffer(device, arena, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                        sizeof(vertex) * m.vertices.size(), {}, vk::MemoryPropertyFlagBits::eDeviceLocal, queue_families);
+    ret.vertex_allocation = vertex_ret.first;
+    ret.vertex_buffer = vertex_ret.second;
+    stage_upload(uploader, ret.vertex_buffer, m.vertices.data(), sizeof(vertex) * m.vertices.size());
+
+    if (m.vertices.size() <= UINT16_MAX)
+    {
+        std::vector<uint16_t> short_indices(m.indices.begin(), m.indices.end());
+        ret.index_type = vk::IndexType::eUint16;
+        auto index_ret = create_arena_buffer(device, arena, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                            sizeof(uint16_t) * short_indices.size(), {}, vk::MemoryPropertyFlagBits::eDeviceLocal, queue_families);
+        ret.index_allocation = index_ret.first;
+        ret.index_buffer = index_ret.second;
+        stage_upload(uploader, ret.index_buffer, short_indices.data(), sizeof(uint16_t) * short_indices.size());
+    }
+    else
+    {
+        ret.index_type = vk::IndexType::eUint32;
+        auto index_ret = create_arena_buffer(device, arena, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                            sizeof(uint32_t) * m.indices.size(), {}, vk::MemoryPropertyFlagBits::eDeviceLocal, queue_families);
+        ret.index_allocation = index_ret.first;
+        ret.index_buffer = index_ret.second;
+        stage_upload(uploader, ret.index_buffer, m.indices.data(), sizeof(uint32_t) * m.indices.size());
+    }
+    return ret;
+}
+
+void destroy_gpu_mesh(const vk::Device &device, memory_arena &arena, gpu_mesh &m)
+{
+    device.destroyBuffer(m.vertex_buffer);
+    arena_free(arena, m.vertex_allocation);
+    device.destroyBuffer(m.index_buffer);
+    arena_free(arena, m.index_allocation);
+}
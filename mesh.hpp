@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include "arena.hpp"
+#include "memory.hpp"
+
+struct vertex
+{
+    glm::vec2 position;
+    glm::vec3 color;
+};
+
+// How per instance transforms are laid out. Both are read as packed floats by vertex.vert and cull.comp
+// from storage buffers indexed by gl_InstanceIndex, so the structs must stay free of padding
+enum class transform_format
+{
+    affine_2d,  // mat2 + translation, 24 bytes of transform, enough for anything that stays in 2D
+    matrix      // full mat4, 64 bytes
+};
+
+struct affine_instance
+{
+    glm::vec4 linear;       // the mat2 columns, scale and rotation
+    glm::vec2 translation;
+    glm::vec3 color;
+};
+
+struct matrix_instance
+{
+    glm::mat4 transform;
+    glm::vec3 color;
+};
+
+inline uint32_t instance_stride(transform_format format)
+{
+    return format == transform_format::matrix ? sizeof(matrix_instance) : sizeof(affine_instance);
+}
+
+struct mesh
+{
+    std::vector<vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// A mesh living in device local memory, indices are stored as 16 bit when the vertex count allows it
+struct gpu_mesh
+{
+    vk::Buffer vertex_buffer;
+    arena_allocation vertex_allocation;
+    vk::Buffer index_buffer;
+    arena_allocation index_allocation;
+    vk::IndexType index_type;
+    uint32_t index_count;
+};
+
+// Writes one instance of a unit mesh scaled to size and centered on position, in the given layout.
+// dst has to have room for instance_stride(format) bytes
+void write_quad_instance(char *dst, transform_format format, glm::vec2 position, glm::vec2 size, glm::vec3 color);
+// 4 corners going around the quad, drawn as the triangles 0 1 2 and 0 2 3
+mesh quad_mesh(float width, float height);
+// Queues the copies on the uploader, they land once it is flushed
+gpu_mesh upload_mesh(const vk::Device &device, memory_arena &arena, staging_uploader &uploader, const mesh &m, const std::vector<uint32_t> &queue_families);
+void destroy_gpu_mesh(const vk::Device &device, memory_arena &arena, gpu_mesh &m);
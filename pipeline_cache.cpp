@@ -0,0 +1,179 @@
+#include "pipeline_cache.hpp"
+#include <print>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t cache_magic = 0x43505654; // "TVPC"
+    constexpr uint32_t cache_version = 1;
+
+    struct cache_file_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+    };
+
+    cache_file_header make_header(vk::PhysicalDevice selected_physical_device, uint64_t data_size)
+    {
+        vk::PhysicalDeviceProperties properties = selected_physical_device.getProperties();
+        cache_file_header header{};
+        header.magic = cache_magic;
+        header.version = cache_version;
+        header.vendor_id = properties.vendorID;
+        header.device_id = properties.deviceID;
+        header.driver_version = properties.driverVersion;
+        memcpy(header.uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+        header.data_size = data_size;
+        return header;
+    }
+
+    // Returns the driver blob if the file exists and was written by this exact device and driver
+    std::vector<char> read_cache_file(const std::string &path, vk::PhysicalDevice selected_physical_device)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return {};
+
+        cache_file_header header{};
+        if (!file.read((char*)&header, sizeof(header)))
+        {
+            std::println("Pipeline cache {} is truncated, ignoring it", path);
+            return {};
+        }
+        cache_file_header expected = make_header(selected_physical_device, header.data_size);
+        if (header.magic != expected.magic || header.version != expected.version)
+        {
+            std::println("Pipeline cache {} has an unknown format, ignoring it", path);
+            return {};
+        }
+        if (header.vendor_id != expected.vendor_id || header.device_id != expected.device_id || header.driver_version != expected.driver_version
+            || memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0)
+        {
+            std::println("Pipeline cache {} was made by another device or driver, ignoring it", path);
+            return {};
+        }
+
+        // The size comes from the file too, check it against what is really there before allocating
+        std::error_code error;
+        uintmax_t file_size = std::filesystem::file_size(path, error);
+        if (error || file_size < sizeof(header) || header.data_size != file_size - sizeof(header))
+        {
+            std::println("Pipeline cache {} has the wrong size, ignoring it", path);
+            return {};
+        }
+
+        std::vector<char> data(header.data_size);
+        if (!file.read(data.data(), data.size()))
+        {
+            std::println("Pipeline cache {} is truncated, ignoring it", path);
+            return {};
+        }
+        return data;
+    }
+}
+
+pipeline_cache create_pipeline_cache(const vk::Device &device, vk::PhysicalDevice selected_physical_device, const std::string &path, bool ignore_disk)
+{
+    pipeline_cache cache{};
+    cache.device = device;
+    cache.path = path;
+
+    std::vector<char> data;
+    if (!ignore_disk)
+        data = read_cache_file(path, selected_physical_device);
+    cache.loaded = !data.empty();
+
+    vk::PipelineCacheCreateInfo cache_info = {};
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.data();
+    cache.cache = device.createPipelineCache(cache_info);
+    if (cache.loaded)
+        std::println("Loaded {} bytes of pipeline cache from {}", data.size(), path);
+    return cache;
+}
+
+// Creation feedback is core since 1.3, it tells us if the driver found the pipeline in our cache
+static void count_pipeline(pipeline_cache &cache, const vk::PipelineCreationFeedback &feedback, std::chrono::steady_clock::duration time)
+{
+    cache.create_ms += std::chrono::duration<double, std::milli>(time).count();
+    cache.pipelines++;
+    if ((feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid) && (feedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit))
+        cache.hits++;
+    else
+        cache.misses++;
+}
+
+vk::Pipeline create_cached_graphics_pipeline(pipeline_cache &cache, vk::GraphicsPipelineCreateInfo pipeline_info)
+{
+    vk::PipelineCreationFeedback feedback = {};
+    vk::PipelineCreationFeedbackCreateInfo feedback_info = {};
+    feedback_info.pPipelineCreationFeedback = &feedback;
+    feedback_info.pNext = pipeline_info.pNext;
+    pipeline_info.pNext = &feedback_info;
+
+    auto start = std::chrono::steady_clock::now();
+    auto pipeline_result = cache.device.createGraphicsPipeline(cache.cache, pipeline_info);
+    auto end = std::chrono::steady_clock::now();
+    if (pipeline_result.result != vk::Result::eSuccess)
+        throw std::runtime_error("Pipeline creation failed!");
+    count_pipeline(cache, feedback, end - start);
+    return pipeline_result.value;
+}
+
+vk::Pipeline create_cached_compute_pipeline(pipeline_cache &cache, vk::ComputePipelineCreateInfo pipeline_info)
+{
+    vk::PipelineCreationFeedback feedback = {};
+    vk::PipelineCreationFeedbackCreateInfo feedback_info = {};
+    feedback_info.pPipelineCreationFeedback = &feedback;
+    feedback_info.pNext = pipeline_info.pNext;
+    pipeline_info.pNext = &feedback_info;
+
+    auto start = std::chrono::steady_clock::now();
+    auto pipeline_result = cache.device.createComputePipeline(cache.cache, pipeline_info);
+    auto end = std::chrono::steady_clock::now();
+    if (pipeline_result.result != vk::Result::eSuccess)
+        throw std::runtime_error("Compute pipeline creation failed!");
+    count_pipeline(cache, feedback, end - start);
+    return pipeline_result.value;
+}
+
+bool save_pipeline_cache(pipeline_cache &cache, vk::PhysicalDevice selected_physical_device)
+{
+    std::vector<uint8_t> data = cache.device.getPipelineCacheData(cache.cache);
+    cache_file_header header = make_header(selected_physical_device, data.size());
+
+    std::string temp_path = cache.path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)data.data(), data.size());
+        if (!file)
+        {
+            std::println("Couldnt write the pipeline cache to {}", temp_path);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache.path, error);
+    if (error)
+    {
+        std::println("Couldnt move the pipeline cache to {}: {}", cache.path, error.message());
+        return false;
+    }
+    return true;
+}
+
+void destroy_pipeline_cache(pipeline_cache &cache)
+{
+    cache.device.destroyPipelineCache(cache.cache);
+    cache.cache = nullptr;
+}
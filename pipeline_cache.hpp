@@ -0,0 +1,26 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <string>
+
+// A vk::PipelineCache that survives restarts. The blob on disk starts with our own header so a
+// cache from another GPU or driver is thrown away instead of handed to the driver
+struct pipeline_cache
+{
+    vk::Device device;
+    vk::PipelineCache cache;
+    std::string path;
+    bool loaded;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t pipelines;
+    double create_ms;
+};
+
+// Loads path if it exists and matches this device, starts empty otherwise (or when ignore_disk is set)
+pipeline_cache create_pipeline_cache(const vk::Device &device, vk::PhysicalDevice selected_physical_device, const std::string &path, bool ignore_disk = false);
+// Same as device.createGraphicsPipeline but goes through the cache and counts hits, misses and time spent
+vk::Pipeline create_cached_graphics_pipeline(pipeline_cache &cache, vk::GraphicsPipelineCreateInfo pipeline_info);
+vk::Pipeline create_cached_compute_pipeline(pipeline_cache &cache, vk::ComputePipelineCreateInfo pipeline_info);
+// Writes the current cache contents next to path and renames it over, a crash never leaves half a file
+bool save_pipeline_cache(pipeline_cache &cache, vk::PhysicalDevice selected_physical_device);
+void destroy_pipeline_cache(pipeline_cache &cache);
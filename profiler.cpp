@@ -0,0 +1,169 @@
+#include "profiler.hpp"
+#include "benchmark.hpp"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <print>
+#include <string_view>
+
+profiler global_profiler;
+
+uint64_t profile_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - global_profiler.epoch).count();
+}
+
+uint32_t profile_thread_id()
+{
+    static std::atomic<uint32_t> next_id = 0;
+    thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void push_profile_event(const profile_event &event)
+{
+    uint64_t index = global_profiler.head.fetch_add(1, std::memory_order_relaxed);
+    profile_slot &slot = global_profiler.slots[index & (profiler::capacity - 1)];
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+std::vector<profile_event> collect_profile_events()
+{
+    uint64_t head = global_profiler.head.load(std::memory_order_acquire);
+    uint64_t first = head > profiler::capacity ? head - profiler::capacity : 0;
+    std::vector<profile_event> events;
+    events.reserve(head - first);
+    for (uint64_t index = first; index < head; index++)
+    {
+        profile_slot &slot = global_profiler.slots[index & (profiler::capacity - 1)];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        // Still being written or already overwritten by a newer lap
+        if (before != index * 2 + 2)
+            continue;
+        profile_event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before)
+            continue;
+        events.push_back(event);
+    }
+    return events;
+}
+
+void print_profile_summary()
+{
+    std::map<std::string_view, std::vector<double>> zones;
+    for (auto &event: collect_profile_events())
+        zones[event.name].push_back(event.duration_ns / 1e6);
+
+    std::println("{:<20} {:>7} {:>9} {:>9} {:>9} (ms)", "zone", "count", "min", "avg", "p99");
+    for (auto &[name, samples]: zones)
+    {
+        double min = *std::min_element(samples.begin(), samples.end());
+        double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        std::println("{:<20} {:>7} {:>9.3f} {:>9.3f} {:>9.3f}", name, samples.size(), min, avg, percentile(samples, 99.0));
+    }
+}
+
+bool write_chrome_trace(const char *path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        std::println("Couldnt open {} for the trace", path);
+        return false;
+    }
+    file << "{\"traceEvents\":[\n";
+    file << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"GPU\"}}}}", gpu_thread_id);
+    for (auto &event: collect_profile_events())
+    {
+        // Chrome wants microseconds
+        file << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                            event.name, event.thread, event.start_ns / 1e3, event.duration_ns / 1e3);
+    }
+    file << "\n]}\n";
+    std::println("Wrote the trace to {}", path);
+    return (bool)file;
+}
+
+gpu_timer create_gpu_timer(const vk::Device &device, vk::PhysicalDevice selected_physical_device, uint32_t queue_family, uint32_t frames_in_flight, uint32_t max_zones)
+{
+    gpu_timer timer{};
+    timer.device = device;
+    timer.max_zones = max_zones;
+    timer.period_ns = selected_physical_device.getProperties().limits.timestampPeriod;
+    timer.names.resize(frames_in_flight * max_zones);
+    timer.zone_counts.resize(frames_in_flight);
+
+    if (selected_physical_device.getQueueFamilyProperties()[queue_family].timestampValidBits == 0)
+    {
+        std::println("Queue family {} has no timestamps, GPU zones are disabled", queue_family);
+        return timer;
+    }
+    vk::QueryPoolCreateInfo pool_info = {};
+    pool_info.queryType = vk::QueryType::eTimestamp;
+    pool_info.queryCount = frames_in_flight * max_zones * 2;
+    timer.pool = device.createQueryPool(pool_info);
+    return timer;
+}
+
+void gpu_timer_begin_frame(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame)
+{
+    timer.zone_counts[frame] = 0;
+    if (timer.pool)
+        command_buffer.resetQueryPool(timer.pool, frame * timer.max_zones * 2, timer.max_zones * 2);
+}
+
+uint32_t gpu_zone_begin(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame, const char *name)
+{
+    uint32_t zone = timer.zone_counts[frame];
+    if (!timer.pool || zone == timer.max_zones)
+        return UINT32_MAX;
+    timer.zone_counts[frame]++;
+    timer.names[frame * timer.max_zones + zone] = name;
+    command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timer.pool, (frame * timer.max_zones + zone) * 2);
+    return zone;
+}
+
+void gpu_zone_end(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame, uint32_t zone)
+{
+    if (zone == UINT32_MAX)
+        return;
+    command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timer.pool, (frame * timer.max_zones + zone) * 2 + 1);
+}
+
+void collect_gpu_zones(gpu_timer &timer, uint32_t frame, std::chrono::steady_clock::time_point submit_time)
+{
+    uint32_t count = timer.zone_counts[frame];
+    if (!timer.pool || count == 0)
+        return;
+    std::vector<uint64_t> timestamps(count * 2);
+    vk::Result result = timer.device.getQueryPoolResults(timer.pool, frame * timer.max_zones * 2, count * 2, timestamps.size() * sizeof(uint64_t),
+                                                        timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess)
+        return;
+
+    uint64_t base_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(submit_time - global_profiler.epoch).count();
+    uint64_t first = timestamps[0];
+    for (uint32_t zone = 0; zone < count; zone++)
+        first = std::min(first, timestamps[zone * 2]);
+    for (uint32_t zone = 0; zone < count; zone++)
+    {
+        uint64_t start = timestamps[zone * 2];
+        uint64_t end = std::max(timestamps[zone * 2 + 1], start);
+        push_profile_event({timer.names[frame * timer.max_zones + zone], base_ns + (uint64_t)((start - first) * timer.period_ns),
+                            (uint64_t)((end - start) * timer.period_ns), gpu_thread_id});
+    }
+    timer.zone_counts[frame] = 0;
+}
+
+void destroy_gpu_timer(gpu_timer &timer)
+{
+    if (timer.pool)
+        timer.device.destroyQueryPool(timer.pool);
+    timer.pool = nullptr;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// One finished zone. Names are string literals so recording never allocates
+struct profile_event
+{
+    const char *name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t thread;
+};
+
+// A slot is being written while its sequence is odd, readers skip it or retry
+struct profile_slot
+{
+    std::atomic<uint64_t> sequence;
+    profile_event event;
+};
+
+// Lock free ring of the most recent zones from every thread, old ones are overwritten.
+// It is also the window the rolling summary is computed over
+struct profiler
+{
+    static constexpr uint64_t capacity = 1 << 16;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> head = 0;
+    std::unique_ptr<profile_slot[]> slots = std::make_unique<profile_slot[]>(capacity);
+};
+
+extern profiler global_profiler;
+
+// GPU zones show up on their own row in the trace
+constexpr uint32_t gpu_thread_id = 1000;
+
+uint64_t profile_now_ns();
+uint32_t profile_thread_id();
+void push_profile_event(const profile_event &event);
+// Copies out every event still in the ring, oldest first
+std::vector<profile_event> collect_profile_events();
+// min/avg/p99 per zone name over whatever the ring holds right now
+void print_profile_summary();
+// Chrome trace_event JSON, open it in chrome://tracing or ui.perfetto.dev
+bool write_chrome_trace(const char *path);
+
+// Times its own scope on the calling thread
+struct profile_zone
+{
+    const char *name;
+    uint64_t start_ns;
+
+    profile_zone(const char *zone_name) : name(zone_name), start_ns(profile_now_ns()) {}
+    ~profile_zone()
+    {
+        end();
+    }
+    // Closes the zone early, for stretches of code that dont line up with a scope
+    void end()
+    {
+        if (name)
+            push_profile_event({name, start_ns, profile_now_ns() - start_ns, profile_thread_id()});
+        name = nullptr;
+    }
+};
+
+// Timestamp queries around parts of a frame's command buffer, one block of queries per frame in flight.
+// Does nothing when the queue has no timestamp support
+struct gpu_timer
+{
+    vk::Device device;
+    vk::QueryPool pool;
+    uint32_t max_zones;
+    double period_ns;
+    std::vector<const char *> names;     // [frame * max_zones + zone]
+    std::vector<uint32_t> zone_counts;   // per frame
+};
+
+gpu_timer create_gpu_timer(const vk::Device &device, vk::PhysicalDevice selected_physical_device, uint32_t queue_family, uint32_t frames_in_flight, uint32_t max_zones);
+// Resets the frame's queries, record it before any zone and outside a render pass
+void gpu_timer_begin_frame(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame);
+uint32_t gpu_zone_begin(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame, const char *name);
+void gpu_zone_end(gpu_timer &timer, vk::CommandBuffer command_buffer, uint32_t frame, uint32_t zone);
+// Reads back a finished frame and pushes its zones into the profiler. There is no shared clock with the CPU,
+// so the first zone is placed at submit_time and the others keep their GPU offsets from it
+void collect_gpu_zones(gpu_timer &timer, uint32_t frame, std::chrono::steady_clock::time_point submit_time);
+void destroy_gpu_timer(gpu_timer &timer);
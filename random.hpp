@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+// PCG32 (pcg-random.org), 16 bytes of state and a handful of instructions per number.
+// Generators made with the same seed and different streams give independent sequences,
+// so every thread can get its own with make_rng(seed, thread_index) and stay deterministic
+struct pcg32
+{
+    uint64_t state;
+    uint64_t increment;
+};
+
+inline uint32_t next_u32(pcg32 &rng)
+{
+    uint64_t old = rng.state;
+    rng.state = old * 6364136223846793005ull + rng.increment;
+    uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+    uint32_t rotation = (uint32_t)(old >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31));
+}
+
+inline pcg32 make_rng(uint64_t seed, uint64_t stream = 0)
+{
+    pcg32 rng = {0, (stream << 1u) | 1u};
+    next_u32(rng);
+    rng.state += seed;
+    next_u32(rng);
+    return rng;
+}
+
+// [0, 1) with the full 24 bits a float can hold
+inline float next_float(pcg32 &rng)
+{
+    return (next_u32(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// [min, max)
+inline float random_range(pcg32 &rng, float min, float max)
+{
+    return min + (max - min) * next_float(rng);
+}
@@ -0,0 +1,104 @@
+#include "recorder.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+static void record_slice(command_recorder &recorder, uint32_t thread)
+{
+    profile_zone zone("record slice");
+    uint32_t index = recorder.frame * recorder.thread_count + thread;
+    uint32_t slice = (recorder.item_count + recorder.thread_count - 1) / recorder.thread_count;
+    uint32_t first = std::min(thread * slice, recorder.item_count);
+    uint32_t count = std::min(slice, recorder.item_count - first);
+
+    // Resetting the whole pool is cheaper than resetting its buffers one by one
+    recorder.device.resetCommandPool(recorder.pools[index]);
+    vk::CommandBuffer command_buffer = recorder.buffers[index];
+    vk::CommandBufferBeginInfo begin_info = {};
+    begin_info.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    begin_info.pInheritanceInfo = &recorder.inheritance;
+    command_buffer.begin(begin_info);
+    if (count > 0)
+        (*recorder.record)(command_buffer, first, count);
+    command_buffer.end();
+}
+
+static void recorder_thread(command_recorder *recorder, uint32_t thread)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        std::unique_lock lock(recorder->mutex);
+        recorder->work_ready.wait(lock, [&]{ return recorder->quit || recorder->generation != seen; });
+        if (recorder->quit)
+            return;
+        seen = recorder->generation;
+        lock.unlock();
+
+        record_slice(*recorder, thread);
+
+        lock.lock();
+        if (--recorder->pending == 0)
+            recorder->work_done.notify_one();
+    }
+}
+
+void init_command_recorder(command_recorder &recorder, const vk::Device &device, uint32_t queue_family, uint32_t thread_count, uint32_t frames_in_flight)
+{
+    recorder.device = device;
+    recorder.thread_count = std::max(thread_count, 1u);
+    recorder.frames_in_flight = frames_in_flight;
+    recorder.generation = 0;
+    recorder.pending = 0;
+    recorder.quit = false;
+
+    vk::CommandPoolCreateInfo pool_info = {};
+    pool_info.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    pool_info.queueFamilyIndex = queue_family;
+    for (uint32_t i = 0; i < recorder.thread_count * frames_in_flight; i++)
+    {
+        vk::CommandPool pool = device.createCommandPool(pool_info);
+        vk::CommandBufferAllocateInfo alloc_info = vk::CommandBufferAllocateInfo(pool, vk::CommandBufferLevel::eSecondary, 1);
+        recorder.pools.push_back(pool);
+        recorder.buffers.push_back(device.allocateCommandBuffers(alloc_info)[0]);
+    }
+    for (uint32_t i = 1; i < recorder.thread_count; i++)
+        recorder.workers.emplace_back(recorder_thread, &recorder, i);
+}
+
+std::span<const vk::CommandBuffer> record_secondaries(command_recorder &recorder, uint32_t frame, const vk::CommandBufferInheritanceInfo &inheritance,
+                                                        uint32_t item_count, const record_function &record)
+{
+    {
+        std::lock_guard lock(recorder.mutex);
+        recorder.frame = frame;
+        recorder.item_count = item_count;
+        recorder.inheritance = inheritance;
+        recorder.record = &record;
+        recorder.pending = recorder.thread_count - 1;
+        recorder.generation++;
+    }
+    recorder.work_ready.notify_all();
+
+    record_slice(recorder, 0);
+
+    std::unique_lock lock(recorder.mutex);
+    recorder.work_done.wait(lock, [&]{ return recorder.pending == 0; });
+    return std::span<const vk::CommandBuffer>(recorder.buffers).subspan(frame * recorder.thread_count, recorder.thread_count);
+}
+
+void destroy_command_recorder(command_recorder &recorder)
+{
+    {
+        std::lock_guard lock(recorder.mutex);
+        recorder.quit = true;
+    }
+    recorder.work_ready.notify_all();
+    for (auto &worker: recorder.workers)
+        worker.join();
+    recorder.workers.clear();
+    // Destroying a pool frees its command buffers too
+    for (auto &pool: recorder.pools)
+        recorder.device.destroyCommandPool(pool);
+    recorder.pools.clear();
+    recorder.buffers.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Records items [first, first + count) into a secondary command buffer that is already begun.
+// Called from several threads at once, it must not touch shared mutable state
+using record_function = std::function<void(vk::CommandBuffer command_buffer, uint32_t first, uint32_t count)>;
+
+// Splits a list of items across threads, each recording its slice into its own secondary command buffer.
+// Every thread has one command pool per frame in flight so recording never locks and a pool is only
+// reset once the frame that used it has finished
+struct command_recorder
+{
+    vk::Device device;
+    uint32_t thread_count;
+    uint32_t frames_in_flight;
+    std::vector<vk::CommandPool> pools;      // [frame * thread_count + thread]
+    std::vector<vk::CommandBuffer> buffers;  // same layout as pools
+
+    // The calling thread records slice 0, workers[i] records slice i + 1
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    uint64_t generation;
+    uint32_t pending;
+    bool quit;
+
+    // The job being recorded, only written while no worker is busy
+    uint32_t frame;
+    uint32_t item_count;
+    vk::CommandBufferInheritanceInfo inheritance;
+    const record_function *record;
+};
+
+void init_command_recorder(command_recorder &recorder, const vk::Device &device, uint32_t queue_family, uint32_t thread_count, uint32_t frames_in_flight);
+// Records item_count items split evenly across the threads and returns the secondaries to execute, in order.
+// Only call once the previous use of frame has finished on the GPU
+std::span<const vk::CommandBuffer> record_secondaries(command_recorder &recorder, uint32_t frame, const vk::CommandBufferInheritanceInfo &inheritance,
+                                                        uint32_t item_count, const record_function &record);
+void destroy_command_recorder(command_recorder &recorder);
@@ -0,0 +1,39 @@
+#include "rendering.hpp"
+
+draw_state full_target_state(vk::Extent2D extent)
+{
+    draw_state state;
+    state.viewport = vk::Viewport(0.0f, 0.0f, extent.width, extent.height, 0.0f, 1.0f);
+    state.scissor = vk::Rect2D({0, 0}, extent);
+    state.cull_mode = vk::CullModeFlagBits::eNone;
+    state.front_face = vk::FrontFace::eClockwise;
+    state.topology = vk::PrimitiveTopology::eTriangleList;
+    return state;
+}
+
+void set_draw_state(vk::CommandBuffer command_buffer, const draw_state &state)
+{
+    command_buffer.setViewport(0, state.viewport);
+    command_buffer.setScissor(0, state.scissor);
+    command_buffer.setCullMode(state.cull_mode);
+    command_buffer.setFrontFace(state.front_face);
+    command_buffer.setPrimitiveTopology(state.topology);
+}
+
+void begin_color_rendering(vk::CommandBuffer command_buffer, vk::ImageView view, vk::Extent2D extent, vk::ClearValue clear,
+                            vk::RenderingFlags flags)
+{
+    vk::RenderingAttachmentInfo color_attachment = {};
+    color_attachment.imageView = view;
+    color_attachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    color_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+    color_attachment.storeOp = vk::AttachmentStoreOp::eStore;
+    color_attachment.clearValue = clear;
+    vk::RenderingInfo rendering_info = {};
+    rendering_info.flags = flags;
+    rendering_info.renderArea = vk::Rect2D({0, 0}, extent);
+    rendering_info.layerCount = 1;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachments = &color_attachment;
+    command_buffer.beginRendering(rendering_info);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <array>
+
+// Graphics pipelines are built for dynamic rendering, they only know the attachment formats and leave all of
+// this to the command buffer. The same pipeline draws into any target size, with any cull mode and any
+// triangle topology, so a resize or a different draw style never needs another pipeline
+constexpr std::array<vk::DynamicState, 5> pipeline_dynamic_states = {
+    vk::DynamicState::eViewport,
+    vk::DynamicState::eScissor,
+    vk::DynamicState::eCullMode,
+    vk::DynamicState::eFrontFace,
+    vk::DynamicState::ePrimitiveTopology,
+};
+
+// Everything in pipeline_dynamic_states, none of it is inherited so every command buffer sets it before drawing
+struct draw_state
+{
+    vk::Viewport viewport;
+    vk::Rect2D scissor;
+    vk::CullModeFlags cull_mode;
+    vk::FrontFace front_face;
+    vk::PrimitiveTopology topology;
+};
+
+// Covers the whole target, no culling and triangle lists
+draw_state full_target_state(vk::Extent2D extent);
+void set_draw_state(vk::CommandBuffer command_buffer, const draw_state &state);
+
+// Begins rendering into view cleared, the image has to be in color attachment layout already (the frame graph
+// moves it there). Pass eContentsSecondaryCommandBuffers in flags when the draws come from secondaries
+void begin_color_rendering(vk::CommandBuffer command_buffer, vk::ImageView view, vk::Extent2D extent, vk::ClearValue clear,
+                            vk::RenderingFlags flags = {});
@@ -0,0 +1,200 @@
+#include "scene.hpp"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+static_assert(sizeof(vertex) == 5 * sizeof(float), "Scene vertices are stored as 5 packed floats");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Scene colors are stored as 3 packed floats");
+static_assert(std::is_trivially_copyable_v<scene_header> && std::is_trivially_copyable_v<scene_mesh>);
+
+namespace
+{
+    uint64_t align_section(uint64_t offset)
+    {
+        return (offset + scene_alignment - 1) & ~(scene_alignment - 1);
+    }
+
+    // Places the section right after whatever came before it
+    scene_section add_section(uint64_t &offset, uint64_t size)
+    {
+        scene_section section = {align_section(offset), size};
+        offset = section.offset + size;
+        return section;
+    }
+
+    template <typename T>
+    std::span<const T> section_span(const scene_view &scene, const scene_section &section, uint64_t count, const char *name)
+    {
+        // Counts come straight from the file, a huge one would wrap count * sizeof(T) around to a size that passes
+        if (count > scene.file.size / sizeof(T))
+            throw std::runtime_error(std::string("Scene section ") + name + " has more elements than the file can hold");
+        if (section.size != count * sizeof(T))
+            throw std::runtime_error(std::string("Scene section ") + name + " has the wrong size");
+        if (section.offset % scene_alignment != 0 || section.offset > scene.file.size || scene.file.size - section.offset < section.size)
+            throw std::runtime_error(std::string("Scene section ") + name + " is outside the file");
+        return std::span<const T>((const T *)(scene.file.data + section.offset), count);
+    }
+}
+
+bool write_scene(const std::string &path, const bounding_box &player, const entity_store &entities, const std::vector<mesh> &meshes)
+{
+    std::vector<scene_mesh> mesh_table;
+    std::vector<vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (auto &m: meshes)
+    {
+        mesh_table.push_back({(uint32_t)vertices.size(), (uint32_t)m.vertices.size(), (uint32_t)indices.size(), (uint32_t)m.indices.size()});
+        vertices.insert(vertices.end(), m.vertices.begin(), m.vertices.end());
+        indices.insert(indices.end(), m.indices.begin(), m.indices.end());
+    }
+
+    scene_header header{};
+    memcpy(header.magic, scene_magic, sizeof(scene_magic));
+    header.version = scene_version;
+    header.header_size = sizeof(scene_header);
+    header.entity_count = entities.size();
+    header.mesh_count = mesh_table.size();
+    header.player = player;
+
+    // Same order as scene_column
+    const std::vector<float> *float_columns[] = {&entities.x, &entities.y, &entities.velocity_x, &entities.velocity_y,
+                                                &entities.acc_x, &entities.acc_y, &entities.width, &entities.height};
+    std::vector<std::pair<const void *, scene_section>> sections;
+    uint64_t offset = sizeof(scene_header);
+    for (size_t i = 0; i < std::size(float_columns); i++)
+    {
+        header.columns[i] = add_section(offset, float_columns[i]->size() * sizeof(float));
+        sections.push_back({float_columns[i]->data(), header.columns[i]});
+    }
+    header.columns[(size_t)scene_column::color] = add_section(offset, entities.color.size() * sizeof(glm::vec3));
+    sections.push_back({entities.color.data(), header.columns[(size_t)scene_column::color]});
+    header.meshes = add_section(offset, mesh_table.size() * sizeof(scene_mesh));
+    sections.push_back({mesh_table.data(), header.meshes});
+    header.vertices = add_section(offset, vertices.size() * sizeof(vertex));
+    sections.push_back({vertices.data(), header.vertices});
+    header.indices = add_section(offset, indices.size() * sizeof(uint32_t));
+    sections.push_back({indices.data(), header.indices});
+    header.file_size = offset;
+
+    // A half written level would fail validation anyway, but this way the old one survives
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write((const char *)&header, sizeof(header));
+        uint64_t written = sizeof(header);
+        const char padding[scene_alignment] = {};
+        for (auto &[data, section]: sections)
+        {
+            file.write(padding, section.offset - written);
+            file.write((const char *)data, section.size);
+            written = section.offset + section.size;
+        }
+        if (!file)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    return !error;
+}
+
+scene_view open_scene(const std::string &path)
+{
+    scene_view scene{};
+    scene.file = map_file(path);
+    try
+    {
+        if (scene.file.size < sizeof(scene_header))
+            throw std::runtime_error("Scene file is too small");
+        scene.header = (const scene_header *)scene.file.data;
+        const scene_header &header = *scene.header;
+        if (memcmp(header.magic, scene_magic, sizeof(scene_magic)) != 0)
+            throw std::runtime_error("Not a scene file");
+        if (header.version != scene_version || header.header_size != sizeof(scene_header))
+            throw std::runtime_error("Scene file version " + std::to_string(header.version) + " isnt supported");
+        if (header.file_size != scene.file.size)
+            throw std::runtime_error("Scene file is truncated");
+
+        uint64_t count = header.entity_count;
+        scene.x = section_span<float>(scene, header.columns[(size_t)scene_column::x], count, "x");
+        scene.y = section_span<float>(scene, header.columns[(size_t)scene_column::y], count, "y");
+        scene.velocity_x = section_span<float>(scene, header.columns[(size_t)scene_column::velocity_x], count, "velocity_x");
+        scene.velocity_y = section_span<float>(scene, header.columns[(size_t)scene_column::velocity_y], count, "velocity_y");
+        scene.acc_x = section_span<float>(scene, header.columns[(size_t)scene_column::acc_x], count, "acc_x");
+        scene.acc_y = section_span<float>(scene, header.columns[(size_t)scene_column::acc_y], count, "acc_y");
+        scene.width = section_span<float>(scene, header.columns[(size_t)scene_column::width], count, "width");
+        scene.height = section_span<float>(scene, header.columns[(size_t)scene_column::height], count, "height");
+        scene.color = section_span<glm::vec3>(scene, header.columns[(size_t)scene_column::color], count, "color");
+        scene.meshes = section_span<scene_mesh>(scene, header.meshes, header.mesh_count, "meshes");
+        scene.vertices = section_span<vertex>(scene, header.vertices, header.vertices.size / sizeof(vertex), "vertices");
+        scene.indices = section_span<uint32_t>(scene, header.indices, header.indices.size / sizeof(uint32_t), "indices");
+
+        // The mesh table is tiny, every range and index gets checked so nothing downstream can read out of bounds
+        for (auto &m: scene.meshes)
+        {
+            // Nothing can upload an empty mesh, buffers cant be 0 bytes
+            if (m.vertex_count == 0 || m.index_count == 0)
+                throw std::runtime_error("Scene mesh is empty");
+            if ((uint64_t)m.first_vertex + m.vertex_count > scene.vertices.size() || (uint64_t)m.first_index + m.index_count > scene.indices.size())
+                throw std::runtime_error("Scene mesh points outside the vertex or index data");
+            for (uint32_t i = 0; i < m.index_count; i++)
+            {
+                if (scene.indices[m.first_index + i] >= m.vertex_count)
+                    throw std::runtime_error("Scene mesh uses a vertex it doesnt have");
+            }
+        }
+    }
+    catch (...)
+    {
+        unmap_file(scene.file);
+        throw;
+    }
+    return scene;
+}
+
+void close_scene(scene_view &scene)
+{
+    unmap_file(scene.file);
+    scene = scene_view{};
+}
+
+void load_scene_entities(const scene_view &scene, entity_store &store)
+{
+    store.x.assign(scene.x.begin(), scene.x.end());
+    store.y.assign(scene.y.begin(), scene.y.end());
+    store.velocity_x.assign(scene.velocity_x.begin(), scene.velocity_x.end());
+    store.velocity_y.assign(scene.velocity_y.begin(), scene.velocity_y.end());
+    store.acc_x.assign(scene.acc_x.begin(), scene.acc_x.end());
+    store.acc_y.assign(scene.acc_y.begin(), scene.acc_y.end());
+    store.width.assign(scene.width.begin(), scene.width.end());
+    store.height.assign(scene.height.begin(), scene.height.end());
+    store.color.assign(scene.color.begin(), scene.color.end());
+}
+
+mesh get_scene_mesh(const scene_view &scene, size_t index)
+{
+    const scene_mesh &m = scene.meshes[index];
+    mesh ret;
+    auto vertices = scene.vertices.subspan(m.first_vertex, m.vertex_count);
+    auto indices = scene.indices.subspan(m.first_index, m.index_count);
+    ret.vertices.assign(vertices.begin(), vertices.end());
+    ret.indices.assign(indices.begin(), indices.end());
+    return ret;
+}
+
+size_t check_scene_entities(const scene_view &scene)
+{
+    size_t bad = 0;
+    for (size_t i = 0; i < scene.x.size(); i++)
+    {
+        bool finite = std::isfinite(scene.x[i]) && std::isfinite(scene.y[i]) && std::isfinite(scene.velocity_x[i]) && std::isfinite(scene.velocity_y[i])
+                    && std::isfinite(scene.acc_x[i]) && std::isfinite(scene.acc_y[i]) && std::isfinite(scene.width[i]) && std::isfinite(scene.height[i]);
+        if (!finite || !(scene.width[i] > 0.0f) || !(scene.height[i] > 0.0f))
+            bad++;
+    }
+    return bad;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "entities.hpp"
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+
+// Binary level file. A header followed by 64 byte aligned sections, one per entity_store column plus the
+// mesh table, its vertices and indices, all stored exactly as they sit in memory (little endian) so
+// opening a level is mapping it and pointing spans into it
+constexpr char scene_magic[8] = {'V', 'K', 'S', 'C', 'E', 'N', 'E', '\0'};
+constexpr uint32_t scene_version = 1;
+constexpr uint64_t scene_alignment = 64;
+
+enum class scene_column
+{
+    x,
+    y,
+    velocity_x,
+    velocity_y,
+    acc_x,
+    acc_y,
+    width,
+    height,
+    color,
+    count
+};
+
+struct scene_section
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct scene_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    uint64_t entity_count;
+    uint64_t mesh_count;
+    bounding_box player;    // where the player starts
+    scene_section columns[(size_t)scene_column::count];
+    scene_section meshes;
+    scene_section vertices;
+    scene_section indices;
+};
+
+// Ranges into the shared vertex and index sections
+struct scene_mesh
+{
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+// An open level, every span points into the mapping and stays valid until close_scene
+struct scene_view
+{
+    mapped_file file;
+    const scene_header *header;
+    std::span<const float> x;
+    std::span<const float> y;
+    std::span<const float> velocity_x;
+    std::span<const float> velocity_y;
+    std::span<const float> acc_x;
+    std::span<const float> acc_y;
+    std::span<const float> width;
+    std::span<const float> height;
+    std::span<const glm::vec3> color;
+    std::span<const scene_mesh> meshes;
+    std::span<const vertex> vertices;
+    std::span<const uint32_t> indices;
+};
+
+// Writes to a temporary file and renames it over path, false if anything failed
+bool write_scene(const std::string &path, const bounding_box &player, const entity_store &entities, const std::vector<mesh> &meshes);
+// Maps the file and checks the header and every section against the file size, never looks at the entities
+// themselves so it costs the same for 10 or 10M of them. Throws if anything is off
+scene_view open_scene(const std::string &path);
+void close_scene(scene_view &scene);
+// Bulk copies the columns into a store the simulation can change
+void load_scene_entities(const scene_view &scene, entity_store &store);
+mesh get_scene_mesh(const scene_view &scene, size_t index);
+// Walks every entity looking for non finite values or empty boxes, returns how many are bad
+size_t check_scene_entities(const scene_view &scene);
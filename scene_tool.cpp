@@ -0,0 +1,104 @@
+#include <print>
+#include <chrono>
+#include <string_view>
+#include "scene.hpp"
+#include "waves.hpp"
+
+// Writes and checks level files for vk_test --scene
+//   scene_tool export OUT [--entities N] [--seed S]   generates the default runner level
+//   scene_tool validate FILE                          checks it and times how long loading takes
+
+static int export_level(const char *path, size_t entity_count, uint32_t seed)
+{
+    bounding_box player{};
+    player.height = 0.2f;
+    player.width = 0.1f;
+    player.accY = 1.3f;
+    player.x = -0.8f;
+    player.y = -0.5f;
+
+    // Same boxes the default waves make, queued up off the right edge so they arrive one after another
+    pcg32 rng = make_rng(seed);
+    enemy_archetype archetype = default_enemy_archetype();
+    entity_store enemies;
+    reserve_entities(enemies, entity_count);
+    float x = 0.8f;
+    for (size_t i = 0; i < entity_count; i++)
+    {
+        bounding_box box = make_enemy_box(rng, archetype, x);
+        glm::vec3 color = {random_range(rng, 0.3f, 1.0f), random_range(rng, 0.3f, 1.0f), random_range(rng, 0.3f, 1.0f)};
+        add_entity(enemies, box, color);
+        // Spread by time to arrival so faster boxes dont overtake slower ones too often
+        x += random_range(rng, 0.8f, 2.0f) * -box.velocityX;
+    }
+
+    // Not drawn yet, the game draws every entity with its own unit quad
+    std::vector<mesh> meshes = {quad_mesh(1.0f, 1.0f)};
+    if (!write_scene(path, player, enemies, meshes))
+    {
+        std::println("Couldnt write {}", path);
+        return 1;
+    }
+    std::println("Wrote {} with {} entities and {} meshes", path, enemies.size(), meshes.size());
+    return 0;
+}
+
+static int validate_level(const char *path)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    auto start = std::chrono::steady_clock::now();
+    scene_view scene;
+    try
+    {
+        scene = open_scene(path);
+    }
+    catch (std::exception &e)
+    {
+        std::println("{} is invalid: {}", path, e.what());
+        return 1;
+    }
+    auto opened = std::chrono::steady_clock::now();
+    entity_store store;
+    load_scene_entities(scene, store);
+    auto loaded = std::chrono::steady_clock::now();
+    size_t bad = check_scene_entities(scene);
+
+    std::println("{}: version {}, {} bytes, {} entities, {} meshes ({} vertices, {} indices)", path, scene.header->version, scene.file.size,
+                scene.header->entity_count, scene.meshes.size(), scene.vertices.size(), scene.indices.size());
+    std::println("Open and validate {:.3f} ms, copy into an entity store {:.3f} ms", ms(opened - start).count(), ms(loaded - opened).count());
+    close_scene(scene);
+    if (bad > 0)
+    {
+        std::println("{} entities have non finite values or empty boxes", bad);
+        return 1;
+    }
+    std::println("Scene is valid");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && std::string_view(argv[1]) == "export")
+    {
+        size_t entity_count = 1000;
+        uint32_t seed = 1;
+        for (int i = 3; i < argc; i++)
+        {
+            std::string_view arg = argv[i];
+            if (arg == "--entities" && i + 1 < argc)
+                entity_count = std::stoull(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc)
+                seed = std::stoul(argv[++i]);
+            else
+            {
+                std::println("Unknown option {}", arg);
+                return -1;
+            }
+        }
+        return export_level(argv[2], entity_count, seed);
+    }
+    if (argc == 3 && std::string_view(argv[1]) == "validate")
+        return validate_level(argv[2]);
+    std::println("Usage: {} export OUT [--entities N] [--seed S] | validate FILE", argv[0]);
+    return -1;
+}
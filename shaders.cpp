@@ -0,0 +1,63 @@
+#include "shaders.hpp"
+
+namespace
+{
+    // Generated at build time by glslc -mfmt=c, each one is a braced list of SPIR-V words
+    constexpr uint32_t vertex_spv[] =
+    #include "vertex.vert.spv.inc"
+    ;
+    constexpr uint32_t fragment_spv[] =
+    #include "fragment.frag.spv.inc"
+    ;
+    constexpr uint32_t cull_spv[] =
+    #include "cull.comp.spv.inc"
+    ;
+    constexpr uint32_t sprite_vertex_spv[] =
+    #include "sprite.vert.spv.inc"
+    ;
+    constexpr uint32_t sprite_fragment_spv[] =
+    #include "sprite.frag.spv.inc"
+    ;
+
+    constexpr std::array<std::span<const uint32_t>, (size_t)shader_id::count> shader_code = {
+        std::span<const uint32_t>(vertex_spv),
+        std::span<const uint32_t>(fragment_spv),
+        std::span<const uint32_t>(cull_spv),
+        std::span<const uint32_t>(sprite_vertex_spv),
+        std::span<const uint32_t>(sprite_fragment_spv),
+    };
+}
+
+std::span<const uint32_t> get_shader_code(shader_id id)
+{
+    return shader_code[(size_t)id];
+}
+
+shader_registry create_shader_registry(const vk::Device &device)
+{
+    shader_registry registry{};
+    registry.device = device;
+    return registry;
+}
+
+vk::ShaderModule get_shader_module(shader_registry &registry, shader_id id)
+{
+    vk::ShaderModule &module = registry.modules[(size_t)id];
+    if (!module)
+    {
+        std::span<const uint32_t> code = get_shader_code(id);
+        vk::ShaderModuleCreateInfo module_info = vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), code.size_bytes(), code.data());
+        module = registry.device.createShaderModule(module_info);
+    }
+    return module;
+}
+
+void destroy_shader_registry(shader_registry &registry)
+{
+    for (auto &module: registry.modules)
+    {
+        if (module)
+            registry.device.destroyShaderModule(module);
+        module = nullptr;
+    }
+}
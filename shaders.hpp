@@ -0,0 +1,29 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include <span>
+
+// Every shader the app uses. The SPIR-V is compiled by CMake and baked into the executable,
+// add the source under shaders/ and an entry here and in shaders.cpp
+enum class shader_id
+{
+    vertex,
+    fragment,
+    cull,
+    sprite_vertex,
+    sprite_fragment,
+    count
+};
+
+// Hands out shader modules, each one is created the first time it is asked for and kept until destroy
+struct shader_registry
+{
+    vk::Device device;
+    std::array<vk::ShaderModule, (size_t)shader_id::count> modules;
+};
+
+std::span<const uint32_t> get_shader_code(shader_id id);
+shader_registry create_shader_registry(const vk::Device &device);
+vk::ShaderModule get_shader_module(shader_registry &registry, shader_id id);
+void destroy_shader_registry(shader_registry &registry);
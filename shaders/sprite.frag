@@ -0,0 +1,25 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Sampled images and samplers of the bindless heap, see bindless.hpp
+layout(set = 1, binding = 1) uniform texture2D textures[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+// Shares the block with vertex.vert, see draw_constants in bindless.hpp
+layout(push_constant) uniform draw_constants {
+    layout(offset = 4) uint sampler_slot;
+} draw;
+
+layout(location = 0) in vec2 frag_uv;
+layout(location = 1) in vec4 frag_color;
+// Differs between sprites of the same draw, so the index has to be marked non uniform
+layout(location = 2) flat in uint frag_texture;
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    vec4 texel = texture(sampler2D(textures[nonuniformEXT(frag_texture)], samplers[draw.sampler_slot]), frag_uv) * frag_color;
+    if (texel.a < 0.01)
+        discard;
+    out_color = texel;
+}
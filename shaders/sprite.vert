@@ -0,0 +1,27 @@
+#version 450
+
+// Same view as vertex.vert, set 0 is shared with the instanced draw
+layout(set = 0, binding = 0) uniform un{
+    mat4 view;
+} view;
+
+layout(location = 0) in vec2 in_position;
+// One sprite per instance, see sprite_instance in sprites.hpp
+layout(location = 2) in vec4 in_rect;   // center xy, size zw
+layout(location = 3) in vec4 in_uv;     // uv_min xy, uv_max zw
+layout(location = 4) in vec4 in_color;
+layout(location = 5) in uint in_texture; // bindless slot of the atlas page
+
+layout(location = 0) out vec2 frag_uv;
+layout(location = 1) out vec4 frag_color;
+layout(location = 2) flat out uint frag_texture;
+
+void main()
+{
+    // The unit quad goes from -0.5 to 0.5
+    vec2 world = in_rect.xy + in_position * in_rect.zw;
+    gl_Position = view.view * vec4(world, 0.0, 1.0);
+    frag_uv = mix(in_uv.xy, in_uv.zw, in_position + 0.5);
+    frag_color = in_color;
+    frag_texture = in_texture;
+}
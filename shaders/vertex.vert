@@ -1,16 +1,30 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 // x -> -1 (left) 1(right)
 // y -> -1 (top)  1(bottom)
 
-layout( push_constant ) uniform push{
-    mat4 transform;
-}trans;
+// Instance layout, has to match cull.comp and the instance structs in mesh.hpp:
+// false -> mat2 (4 floats) + translation (2) + color (3), true -> mat4 (16 floats) + color (3)
+layout(constant_id = 0) const bool full_transform = false;
 
-layout(binding = 0) uniform un{
+layout(set = 0, binding = 0) uniform un{
     mat4 view;
 } view;
 
+// Every storage buffer in the bindless heap, see bindless.hpp
+layout(std430, set = 1, binding = 0) readonly buffer instance_buffers { float data[]; } buffers[];
+
+// Slot of the buffer with whatever survived culling, indexed by instance. See draw_constants in bindless.hpp
+layout(push_constant) uniform draw_constants {
+    uint instances;
+} draw;
+
+float instance_data(uint index)
+{
+    return buffers[draw.instances].data[index];
+}
+
 layout(location = 0) in vec2 in_position;
 layout(location = 1) in vec3 in_color;
 
@@ -18,6 +32,26 @@ layout(location = 0) out vec3 frag_color;
 
 void main()
 {
-    gl_Position = trans.transform * vec4(in_position, 0.0, 1.0);
-    frag_color = in_color;
-}
\ No newline at end of file
+    vec4 world;
+    vec3 instance_color;
+    if (full_transform)
+    {
+        uint base = gl_InstanceIndex * 19;
+        mat4 transform = mat4(vec4(instance_data(base), instance_data(base + 1), instance_data(base + 2), instance_data(base + 3)),
+                              vec4(instance_data(base + 4), instance_data(base + 5), instance_data(base + 6), instance_data(base + 7)),
+                              vec4(instance_data(base + 8), instance_data(base + 9), instance_data(base + 10), instance_data(base + 11)),
+                              vec4(instance_data(base + 12), instance_data(base + 13), instance_data(base + 14), instance_data(base + 15)));
+        world = transform * vec4(in_position, 0.0, 1.0);
+        instance_color = vec3(instance_data(base + 16), instance_data(base + 17), instance_data(base + 18));
+    }
+    else
+    {
+        uint base = gl_InstanceIndex * 9;
+        mat2 linear = mat2(instance_data(base), instance_data(base + 1), instance_data(base + 2), instance_data(base + 3));
+        vec2 translation = vec2(instance_data(base + 4), instance_data(base + 5));
+        world = vec4(linear * in_position + translation, 0.0, 1.0);
+        instance_color = vec3(instance_data(base + 6), instance_data(base + 7), instance_data(base + 8));
+    }
+    gl_Position = view.view * world;
+    frag_color = in_color * instance_color;
+}
@@ -0,0 +1,245 @@
+#include "simulation.hpp"
+#include "profiler.hpp"
+#include "scene.hpp"
+#include <print>
+#include <algorithm>
+#include <cmath>
+
+static bool simple_physics_step(float t, bounding_box &box, entity_store &boxes, broadphase &bp, bool &on_ground)
+{
+    box.y += box.velocityY * t + 0.5 * box.accY * (t * t);
+    box.velocityY += box.accY * t;
+
+    box.x += box.velocityX * t + 0.5 * box.accX * (t * t);
+    box.velocityX += box.accX * t;
+    bool end_game = false;
+
+    integrate_entities(boxes, t);
+
+    // The player joins the broad phase as the last entity for this step only
+    uint32_t player_index = add_entity(boxes, box, {});
+    find_pairs(bp, boxes);
+    for (auto &pair: bp.pairs)
+    {
+        // Enemies dont react to each other (yet), only the player can end the game
+        if (pair.b != player_index)
+            continue;
+        uint32_t i = pair.a;
+        end_game = true;
+        #ifdef NDEBUG
+        std::println("Collision between pos x: {} y: {} and pos x: {} and pos y: {} ", box.x, box.y, boxes.x[i], boxes.y[i]);
+        std::println("With width: {} and height: {} and width: {} and height: {}", box.width, box.height, boxes.width[i], boxes.height[i]);
+        std::println("Rightmost vertex in position {} collided with leftmost vertex in position {}", box.x + box.width/2, boxes.x[i] - boxes.width[i]/2);
+        #endif
+    }
+    remove_entity(boxes, player_index);
+
+    bool collision_x = box.x + box.width / 2 >= 1.0f || box.x - box.width / 2 <= -1.0f;
+    bool collision_top_y = box.y - box.height / 2 <= -1.0f;
+    bool collision_bottom_y = box.y + box.height / 2 >=1.0f;
+    if (collision_x)
+        box.velocityX = 0;
+    else if (collision_top_y)
+    {
+        box.velocityY = 0;
+        box.y = -1.0f + box.height/2;
+    }
+    else if (collision_bottom_y)
+    {
+        box.velocityY = 0.0f;
+        box.y = 1.0f - box.height/2;
+        on_ground = true;
+    }
+    return end_game;
+}
+
+void init_simulation(simulation &sim, uint32_t seed, float dt)
+{
+    sim.dt = dt;
+    sim.rng = make_rng(seed);
+    sim.waves = default_wave_schedule();
+    sim.player = bounding_box{};
+    sim.player.height = 0.2f;
+    sim.player.width = 0.1f;
+    sim.player.accY = 1.3f;
+    sim.player.x = -0.8;
+    sim.player.y = -0.5;
+    sim.player_previous = {sim.player.x, sim.player.y};
+    // Room for a few rounds of waves before anything has to grow
+    init_entity_pool(sim.enemies, 4096);
+    sim.enemies_previous.clear();
+    sim.enemies_previous.reserve(4096);
+    sim.on_ground = true;
+    sim.jumps = 0;
+    sim.score = 0;
+    sim.lost = false;
+    sim.tick = 0;
+    sim.inputs_applied = 0;
+    sim.recorded_inputs.clear();
+}
+
+void load_simulation_scene(simulation &sim, const scene_view &scene)
+{
+    sim.player = scene.header->player;
+    sim.player_previous = {sim.player.x, sim.player.y};
+    // The first wave waits for a clear field, so the level plays out before the scheduler kicks in
+    load_scene_entities(scene, sim.enemies.store);
+    adopt_store_entities(sim.enemies);
+    sim.enemies_previous.clear();
+}
+
+static void apply_input(simulation &sim, input_action action)
+{
+    if (action == input_action::jump)
+    {
+        if (sim.on_ground || sim.jumps <= 1)
+        {
+            if (sim.jumps <= 1)
+                sim.player.velocityY = -1.2f;
+            sim.on_ground = false;
+            sim.jumps++;
+            std::println("Jumps {}", sim.jumps);
+        }
+    }
+    else if (action == input_action::dive)
+        sim.player.velocityY = 3.0f;
+}
+
+void simulation_tick(simulation &sim)
+{
+    profile_zone zone("simulation tick");
+    if (!sim.lost)
+        update_wave_scheduler(sim.waves, sim.dt, sim.rng, sim.enemies);
+
+    entity_store &enemies = sim.enemies.store;
+    sim.player_previous = {sim.player.x, sim.player.y};
+    sim.enemies_previous.resize(enemies.size());
+    for (size_t i = 0; i < enemies.size(); i++)
+        sim.enemies_previous[i] = {enemies.x[i], enemies.y[i]};
+    sim.tick++;
+
+    // Every press counts, two jumps in one tick are a double jump
+    input_event event;
+    while (sim.input.peek(event) && event.time <= sim.input_deadline)
+    {
+        sim.input.pop(event);
+        apply_input(sim, event.action);
+        sim.recorded_inputs.push_back({sim.tick, event.action});
+        sim.inputs_applied++;
+        sim.last_input_time = event.time;
+    }
+
+    if (sim.lost)
+        return;
+    bool end_game = simple_physics_step(sim.dt, sim.player, enemies, sim.enemy_broadphase, sim.on_ground);
+    if (sim.on_ground)
+        sim.jumps = 0;
+    if (end_game)
+    {
+        std::println("You lost!");
+        std::println("Your score was {}", sim.score);
+        sim.lost = true;
+        #ifndef NDEBUG
+        std::println("Collision between pos x: {} y: {} and pos x: {} and pos y: {} ", sim.player.x, sim.player.y, enemies.x[0], enemies.y[0]);
+        std::println("With width: {} and height: {} and width: {} and height: {}", sim.player.width, sim.player.height, enemies.width[0], enemies.height[0]);
+        std::println("Rightmost vertex in position {} collided with leftmost vertex in position {}", sim.player.x + sim.player.width/2, enemies.x[0] - enemies.width[0]/2);
+        std::println("Jumps {}", sim.jumps);
+        #endif
+    }
+    // Only the enemies that left through the left edge go away, the rest keep going
+    for (size_t i = 0; i < enemies.size();)
+    {
+        if (enemies.x[i] + enemies.width[i]/2 <= -1.0f)
+        {
+            sim.score += (int)(abs((enemies.width[i] * 10)) + abs((enemies.height[i] * 10)) + abs((enemies.velocity_x[i] * 10)));
+            despawn_entity_at(sim.enemies, i);
+            sim.enemies_previous[i] = sim.enemies_previous.back();
+            sim.enemies_previous.pop_back();
+            continue;
+        }
+        i++;
+    }
+}
+
+void publish_snapshot(simulation &sim, std::chrono::steady_clock::time_point time)
+{
+    // Copy assigning into the same slots reuses their capacity, no allocations once warmed up
+    sim_snapshot &snapshot = sim.snapshots.write_slot();
+    snapshot.tick = sim.tick;
+    snapshot.time = time;
+    snapshot.player = sim.player;
+    snapshot.player_previous = sim.player_previous;
+    snapshot.enemies = sim.enemies.store;
+    snapshot.enemies_previous = sim.enemies_previous;
+    snapshot.score = sim.score;
+    snapshot.lost = sim.lost;
+    snapshot.inputs_applied = sim.inputs_applied;
+    snapshot.last_input_time = sim.last_input_time;
+    sim.snapshots.publish();
+}
+
+static void simulation_thread(simulation *sim)
+{
+    using clock = std::chrono::steady_clock;
+    auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(sim->dt));
+    auto start = clock::now();
+    uint64_t first_tick = sim->tick;
+    while (sim->running.load())
+    {
+        auto now = clock::now();
+        uint64_t target = first_tick + (now - start) / step;
+        // After a long stall (debugger, window drag) drop the backlog instead of spiralling
+        if (target > sim->tick + 10)
+        {
+            first_tick += target - (sim->tick + 10);
+            target = sim->tick + 10;
+        }
+        bool stepped = false;
+        while (sim->tick < target)
+        {
+            sim->input_deadline = start + step * (sim->tick + 1 - first_tick);
+            simulation_tick(*sim);
+            stepped = true;
+        }
+        if (stepped)
+            publish_snapshot(*sim, start + step * (sim->tick - first_tick));
+        std::this_thread::sleep_until(start + step * (sim->tick - first_tick + 1));
+    }
+}
+
+void start_simulation_thread(simulation &sim)
+{
+    publish_snapshot(sim, std::chrono::steady_clock::now());
+    sim.running = true;
+    sim.thread = std::thread(simulation_thread, &sim);
+}
+
+void stop_simulation_thread(simulation &sim)
+{
+    sim.running = false;
+    if (sim.thread.joinable())
+        sim.thread.join();
+}
+
+uint64_t simulation_checksum(const simulation &sim)
+{
+    // FNV-1a over the raw bytes, any float that differs in a single bit changes it
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ ((const uint8_t *)data)[i]) * 1099511628211ull;
+    };
+    mix(&sim.player, sizeof(sim.player));
+    mix(&sim.score, sizeof(sim.score));
+    mix(&sim.tick, sizeof(sim.tick));
+    mix(sim.enemies.store.x.data(), sim.enemies.store.size() * sizeof(float));
+    mix(sim.enemies.store.y.data(), sim.enemies.store.size() * sizeof(float));
+    return hash;
+}
+
+float snapshot_alpha(const sim_snapshot &snapshot, float dt, std::chrono::steady_clock::time_point now)
+{
+    float since = std::chrono::duration<float>(now - snapshot.time).count();
+    return std::clamp(since / dt, 0.0f, 1.0f);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "entities.hpp"
+#include "broadphase.hpp"
+#include "triple_buffer.hpp"
+#include "spsc_queue.hpp"
+#include "input.hpp"
+#include "random.hpp"
+#include "waves.hpp"
+
+// Everything the renderer needs from one simulation tick, including where things were one tick
+// earlier so it can interpolate between the two
+struct sim_snapshot
+{
+    uint64_t tick;
+    std::chrono::steady_clock::time_point time;
+    bounding_box player;
+    glm::vec2 player_previous;
+    entity_store enemies;
+    std::vector<glm::vec2> enemies_previous;
+    int score;
+    bool lost;
+    // Newest input applied up to this tick, for input to screen latency
+    uint64_t inputs_applied;
+    std::chrono::steady_clock::time_point last_input_time;
+};
+
+// The game, stepped at a fixed dt either on its own thread or by hand (headless)
+struct simulation
+{
+    float dt;
+    bounding_box player;
+    glm::vec2 player_previous;
+    entity_pool enemies;
+    std::vector<glm::vec2> enemies_previous;    // follows the pool's dense order
+    broadphase enemy_broadphase;
+    pcg32 rng;
+    wave_scheduler waves;
+    bool on_ground;
+    int jumps;
+    int score;
+    bool lost;
+    uint64_t tick;
+
+    // Pushed by the window thread, drained by whichever thread ticks. A tick takes every event
+    // stamped before input_deadline, the time the tick stands for
+    spsc_queue<input_event, 256> input;
+    std::chrono::steady_clock::time_point input_deadline = std::chrono::steady_clock::time_point::max();
+    uint64_t inputs_applied;
+    std::chrono::steady_clock::time_point last_input_time;
+    std::vector<recorded_input> recorded_inputs;
+
+    triple_buffer<sim_snapshot> snapshots;
+    std::atomic_bool running = false;
+    std::thread thread;
+};
+
+struct scene_view;
+
+void init_simulation(simulation &sim, uint32_t seed, float dt);
+// Starts from a level instead of an empty field, enemies only spawn randomly once the level's are gone
+void load_simulation_scene(simulation &sim, const scene_view &scene);
+void simulation_tick(simulation &sim);
+void publish_snapshot(simulation &sim, std::chrono::steady_clock::time_point time);
+// Ticks at 1/dt on a dedicated thread until stopped, publishing a snapshot after every catch up
+void start_simulation_thread(simulation &sim);
+void stop_simulation_thread(simulation &sim);
+// Hash of the state that matters for a replay to count as identical
+uint64_t simulation_checksum(const simulation &sim);
+// How far the renderer is between snapshot.previous and snapshot.current, from 0 to 1
+float snapshot_alpha(const sim_snapshot &snapshot, float dt, std::chrono::steady_clock::time_point now);
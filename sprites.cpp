@@ -0,0 +1,212 @@
+#include "sprites.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+static_assert(sizeof(sprite_instance) == 13 * sizeof(float), "sprite.vert reads 3 vec4 and a uint per instance");
+
+void sprite_batch_begin(sprite_batch &batch)
+{
+    batch.sprites.clear();
+    batch.keys.clear();
+    batch.instance_offset = 0;
+}
+
+void push_sprite(sprite_batch &batch, const sprite &s)
+{
+    batch.sprites.push_back(s);
+}
+
+void build_sprite_batch(sprite_batch &batch, stream_buffer &stream, std::span<const uint32_t> page_textures)
+{
+    // Layer, then push order so sprites on the same layer keep the order they were pushed in. Page in between
+    // keeps sprites sampling the same texture next to each other
+    batch.keys.clear();
+    for (uint32_t i = 0; i < batch.sprites.size(); i++)
+    {
+        const sprite &s = batch.sprites[i];
+        batch.keys.push_back((uint64_t)s.layer << 48 | (uint64_t)(s.region.page & 0xFFFF) << 32 | i);
+    }
+    std::sort(batch.keys.begin(), batch.keys.end());
+
+    sprite_instance *instances = stream_alloc<sprite_instance>(stream, batch.sprites.size(), batch.instance_offset);
+    for (uint32_t i = 0; i < batch.keys.size(); i++)
+    {
+        const sprite &s = batch.sprites[(uint32_t)batch.keys[i]];
+        instances[i].rect = glm::vec4(s.position, s.size);
+        instances[i].uv = glm::vec4(s.region.uv_min, s.region.uv_max);
+        instances[i].color = s.color;
+        instances[i].texture = page_textures[s.region.page];
+    }
+}
+
+sprite_renderer create_sprite_renderer(const vk::Device &device, pipeline_cache &pipelines, shader_registry &shaders,
+                                        vk::PipelineLayout pipeline_layout, bindless_heap &heap, vk::Format color_format)
+{
+    sprite_renderer renderer{};
+    renderer.device = device;
+    renderer.heap = &heap;
+    renderer.pipeline_layout = pipeline_layout;
+
+    // Nearest and clamped, the atlas padding keeps neighbours from bleeding in
+    vk::SamplerCreateInfo sampler_info = {};
+    sampler_info.magFilter = vk::Filter::eNearest;
+    sampler_info.minFilter = vk::Filter::eNearest;
+    sampler_info.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    sampler_info.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    sampler_info.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    sampler_info.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    sampler_info.maxLod = 0.0f;
+    renderer.sampler = device.createSampler(sampler_info);
+    renderer.sampler_slot = bindless_add_sampler(heap, renderer.sampler);
+
+    std::array<vk::PipelineShaderStageCreateInfo, 2> stages;
+    stages[0].stage = vk::ShaderStageFlagBits::eVertex;
+    stages[0].module = get_shader_module(shaders, shader_id::sprite_vertex);
+    stages[0].pName = "main";
+    stages[1].stage = vk::ShaderStageFlagBits::eFragment;
+    stages[1].module = get_shader_module(shaders, shader_id::sprite_fragment);
+    stages[1].pName = "main";
+
+    // Binding 0 is the unit quad shared with the instanced draw, binding 1 the streamed sprites
+    std::array<vk::VertexInputBindingDescription, 2> bindings = {
+        vk::VertexInputBindingDescription(0, sizeof(vertex), vk::VertexInputRate::eVertex),
+        vk::VertexInputBindingDescription(1, sizeof(sprite_instance), vk::VertexInputRate::eInstance),
+    };
+    std::array<vk::VertexInputAttributeDescription, 5> attributes = {
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(vertex, position)),
+        vk::VertexInputAttributeDescription(2, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(sprite_instance, rect)),
+        vk::VertexInputAttributeDescription(3, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(sprite_instance, uv)),
+        vk::VertexInputAttributeDescription(4, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(sprite_instance, color)),
+        vk::VertexInputAttributeDescription(5, 1, vk::Format::eR32Uint, offsetof(sprite_instance, texture)),
+    };
+    vk::PipelineVertexInputStateCreateInfo vertex_input_info = {};
+    vertex_input_info.vertexBindingDescriptionCount = bindings.size();
+    vertex_input_info.pVertexBindingDescriptions = bindings.data();
+    vertex_input_info.vertexAttributeDescriptionCount = attributes.size();
+    vertex_input_info.pVertexAttributeDescriptions = attributes.data();
+
+    vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+    vk::PipelineViewportStateCreateInfo viewport_info(vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr);
+    vk::PipelineDynamicStateCreateInfo dynamic_state_info(vk::PipelineDynamicStateCreateFlags(), pipeline_dynamic_states.size(), pipeline_dynamic_states.data());
+
+    vk::PipelineRasterizationStateCreateInfo raster_info = {};
+    raster_info.polygonMode = vk::PolygonMode::eFill;
+    raster_info.lineWidth = 1.0f;
+    raster_info.cullMode = vk::CullModeFlagBits::eNone;
+    raster_info.frontFace = vk::FrontFace::eClockwise;
+
+    vk::PipelineMultisampleStateCreateInfo multisampling_info = {};
+    multisampling_info.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+    // Plain alpha blending, sprites are drawn back to front by layer
+    vk::PipelineColorBlendAttachmentState blend_attachment = {};
+    blend_attachment.blendEnable = VK_TRUE;
+    blend_attachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+    blend_attachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    blend_attachment.colorBlendOp = vk::BlendOp::eAdd;
+    blend_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    blend_attachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    blend_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+    blend_attachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+    vk::PipelineColorBlendStateCreateInfo color_blend_info = {};
+    color_blend_info.attachmentCount = 1;
+    color_blend_info.pAttachments = &blend_attachment;
+
+    vk::GraphicsPipelineCreateInfo pipeline_info = {};
+    pipeline_info.stageCount = stages.size();
+    pipeline_info.pStages = stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly_info;
+    pipeline_info.pViewportState = &viewport_info;
+    pipeline_info.pDynamicState = &dynamic_state_info;
+    pipeline_info.pRasterizationState = &raster_info;
+    pipeline_info.pMultisampleState = &multisampling_info;
+    pipeline_info.pColorBlendState = &color_blend_info;
+    pipeline_info.layout = renderer.pipeline_layout;
+    vk::PipelineRenderingCreateInfo rendering_info(0, 1, &color_format);
+    pipeline_info.pNext = &rendering_info;
+    pipeline_info.basePipelineIndex = -1;
+    renderer.pipeline = create_cached_graphics_pipeline(pipelines, pipeline_info);
+    return renderer;
+}
+
+void upload_atlas(sprite_renderer &renderer, vk::PhysicalDevice selected_physical_device, staging_uploader &uploader,
+                  const texture_atlas &atlas, const std::vector<uint32_t> &queue_families)
+{
+    const vk::Device &device = renderer.device;
+    vk::PhysicalDeviceMemoryProperties memory_properties = selected_physical_device.getMemoryProperties();
+    for (size_t page = renderer.page_images.size(); page < atlas.pages.size(); page++)
+    {
+        vk::ImageCreateInfo image_info = {};
+        image_info.imageType = vk::ImageType::e2D;
+        // Texels are authored in sRGB, sampling hands the shader linear values
+        image_info.format = vk::Format::eR8G8B8A8Srgb;
+        image_info.extent = vk::Extent3D(atlas.page_size, atlas.page_size, 1);
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = vk::SampleCountFlagBits::e1;
+        image_info.tiling = vk::ImageTiling::eOptimal;
+        image_info.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+        image_info.initialLayout = vk::ImageLayout::eUndefined;
+        if (queue_families.size() > 1)
+        {
+            image_info.sharingMode = vk::SharingMode::eConcurrent;
+            image_info.queueFamilyIndexCount = queue_families.size();
+            image_info.pQueueFamilyIndices = queue_families.data();
+        }
+        vk::Image image = device.createImage(image_info);
+
+        // Pages are few and big, each one gets its own allocation instead of going through the buffer arena
+        vk::MemoryRequirements memory_requirements = device.getImageMemoryRequirements(image);
+        int memory_type = find_memory_type(memory_properties, memory_requirements.memoryTypeBits, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (memory_type == -1)
+            throw std::runtime_error("Didnt find a suitable memory for an atlas page");
+        vk::DeviceMemory memory = device.allocateMemory(vk::MemoryAllocateInfo(memory_requirements.size, memory_type));
+        device.bindImageMemory(image, memory, 0);
+
+        vk::ImageViewCreateInfo view_info = {};
+        view_info.image = image;
+        view_info.viewType = vk::ImageViewType::e2D;
+        view_info.format = image_info.format;
+        view_info.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+        vk::ImageView view = device.createImageView(view_info);
+
+        stage_image_upload(uploader, image, atlas.pages[page].data(), atlas.pages[page].size() * sizeof(uint32_t), image_info.extent);
+        renderer.page_images.push_back(image);
+        renderer.page_memory.push_back(memory);
+        renderer.page_views.push_back(view);
+        renderer.page_textures.push_back(bindless_add_image(*renderer.heap, view));
+    }
+}
+
+void record_sprites(vk::CommandBuffer command_buffer, const sprite_renderer &renderer, const sprite_batch &batch, const stream_buffer &stream,
+                    const gpu_mesh &quad, const draw_state &state, uint32_t first, uint32_t count)
+{
+    if (count == 0)
+        return;
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderer.pipeline);
+    set_draw_state(command_buffer, state);
+    command_buffer.pushConstants<uint32_t>(renderer.pipeline_layout, vk::ShaderStageFlagBits::eAllGraphics,
+                                            offsetof(draw_constants, sampler), renderer.sampler_slot);
+    std::array<vk::Buffer, 2> vertex_buffers = {quad.vertex_buffer, stream.buffer};
+    std::array<vk::DeviceSize, 2> vertex_offsets = {0, batch.instance_offset};
+    command_buffer.bindVertexBuffers(0, vertex_buffers, vertex_offsets);
+    command_buffer.bindIndexBuffer(quad.index_buffer, 0, quad.index_type);
+    command_buffer.drawIndexed(quad.index_count, count, 0, 0, first);
+}
+
+void destroy_sprite_renderer(sprite_renderer &renderer, uint32_t frame)
+{
+    const vk::Device &device = renderer.device;
+    for (size_t i = 0; i < renderer.page_images.size(); i++)
+    {
+        bindless_free(*renderer.heap, bindless_kind::sampled_image, renderer.page_textures[i], frame);
+        device.destroyImageView(renderer.page_views[i]);
+        device.destroyImage(renderer.page_images[i]);
+        device.freeMemory(renderer.page_memory[i]);
+    }
+    bindless_free(*renderer.heap, bindless_kind::sampler, renderer.sampler_slot, frame);
+    device.destroyPipeline(renderer.pipeline);
+    device.destroySampler(renderer.sampler);
+}
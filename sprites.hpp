@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+#include "atlas.hpp"
+#include "stream.hpp"
+#include "memory.hpp"
+#include "mesh.hpp"
+#include "pipeline_cache.hpp"
+#include "shaders.hpp"
+#include "rendering.hpp"
+#include "bindless.hpp"
+
+struct sprite
+{
+    glm::vec2 position; // center
+    glm::vec2 size;
+    sprite_region region;
+    glm::vec4 color;    // multiplied with the texels
+    uint16_t layer;     // higher layers are drawn on top
+};
+
+// Per instance vertex data sprite.vert reads at locations 2 to 5
+struct sprite_instance
+{
+    glm::vec4 rect;     // center xy, size zw
+    glm::vec4 uv;       // uv_min xy, uv_max zw
+    glm::vec4 color;
+    uint32_t texture;   // bindless slot of the page
+};
+
+// Sprites pushed during a frame, sorted by layer then page and written out as instances. Every sprite
+// picks its page by bindless slot, so the whole batch is one draw and instance order keeps the layers right
+struct sprite_batch
+{
+    std::vector<sprite> sprites;
+    std::vector<uint64_t> keys;
+    vk::DeviceSize instance_offset;
+};
+
+void sprite_batch_begin(sprite_batch &batch);
+void push_sprite(sprite_batch &batch, const sprite &s);
+// Sorts what was pushed and streams the instances into stream, page_textures maps atlas pages to bindless slots
+void build_sprite_batch(sprite_batch &batch, stream_buffer &stream, std::span<const uint32_t> page_textures);
+
+// Pipeline and atlas textures for sprites. It uses the same pipeline layout as every other graphics pipeline
+// (see create_bindless_pipeline_layout), the pages and the sampler live in the bindless heap
+struct sprite_renderer
+{
+    vk::Device device;
+    bindless_heap *heap;
+    vk::Sampler sampler;
+    uint32_t sampler_slot;
+    vk::PipelineLayout pipeline_layout;     // not owned
+    vk::Pipeline pipeline;
+    std::vector<vk::Image> page_images;
+    std::vector<vk::DeviceMemory> page_memory;
+    std::vector<vk::ImageView> page_views;
+    std::vector<uint32_t> page_textures;    // bindless slots
+};
+
+sprite_renderer create_sprite_renderer(const vk::Device &device, pipeline_cache &pipelines, shader_registry &shaders,
+                                        vk::PipelineLayout pipeline_layout, bindless_heap &heap, vk::Format color_format);
+// Creates a texture per atlas page and queues their uploads, flush the uploader before drawing.
+// queue_families are every family that touches the pages, like for buffers
+void upload_atlas(sprite_renderer &renderer, vk::PhysicalDevice selected_physical_device, staging_uploader &uploader,
+                  const texture_atlas &atlas, const std::vector<uint32_t> &queue_families);
+// Records sprites [first, first + count) of the batch as a single draw into a command buffer that is rendering
+// into a color_format target, the frame set and the heap have to be bound already
+void record_sprites(vk::CommandBuffer command_buffer, const sprite_renderer &renderer, const sprite_batch &batch, const stream_buffer &stream,
+                    const gpu_mesh &quad, const draw_state &state, uint32_t first, uint32_t count);
+// frame is the frame in flight being recorded, the heap slots are freed as of that frame
+void destroy_sprite_renderer(sprite_renderer &renderer, uint32_t frame);
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed size lock free ring between exactly one producer thread and one consumer thread.
+// Head and tail live on their own cache lines so the two sides dont keep stealing each other's line
+template <typename T, size_t Capacity>
+struct spsc_queue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+    std::array<T, Capacity> items;
+    alignas(64) std::atomic<uint64_t> head = 0; // next slot to write, producer only
+    alignas(64) std::atomic<uint64_t> tail = 0; // next slot to read, consumer only
+
+    // Producer side, false when full
+    bool push(const T &item)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity)
+            return false;
+        items[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, looks at the oldest item without taking it
+    bool peek(T &item) const
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        item = items[t & (Capacity - 1)];
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        if (!peek(item))
+            return false;
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,49 @@
+#include "stream.hpp"
+#include "memory.hpp"
+#include <cstring>
+#include <algorithm>
+
+stream_buffer create_stream_buffer(const vk::Device &device, memory_arena &arena, vk::BufferUsageFlags usage, vk::DeviceSize capacity)
+{
+    stream_buffer stream{};
+    stream.device = device;
+    stream.arena = &arena;
+    stream.usage = usage;
+    stream.capacity = capacity;
+    auto ret = create_arena_buffer(device, arena, usage, capacity,
+                                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    stream.allocation = ret.first;
+    stream.buffer = ret.second;
+    stream.data = stream.allocation.mapped;
+    return stream;
+}
+
+void stream_begin(stream_buffer &stream)
+{
+    stream.bytes_written = 0;
+}
+
+void stream_reserve(stream_buffer &stream, vk::DeviceSize size)
+{
+    if (size <= stream.capacity)
+        return;
+
+    vk::DeviceSize capacity = std::max<vk::DeviceSize>(stream.capacity * 2, 256);
+    while (capacity < size)
+        capacity *= 2;
+    stream_buffer grown = create_stream_buffer(stream.device, *stream.arena, stream.usage, capacity);
+    if (stream.bytes_written > 0)
+        memcpy(grown.data, stream.data, stream.bytes_written);
+    grown.bytes_written = stream.bytes_written;
+    grown.reallocations = stream.reallocations + 1;
+    destroy_stream_buffer(stream);
+    stream = grown;
+}
+
+void destroy_stream_buffer(stream_buffer &stream)
+{
+    stream.device.destroyBuffer(stream.buffer);
+    arena_free(*stream.arena, stream.allocation);
+    stream.buffer = nullptr;
+    stream.data = nullptr;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include "arena.hpp"
+
+// Persistently mapped buffer that per frame data is written straight into. Owned by a single frame
+// in flight so it can be reallocated (after that frame's fence) whenever a frame needs more room,
+// once it has grown to the working set size writing to it never allocates
+struct stream_buffer
+{
+    vk::Device device;
+    memory_arena *arena;
+    vk::BufferUsageFlags usage;
+    vk::Buffer buffer;
+    arena_allocation allocation;
+    char *data;
+    vk::DeviceSize capacity;
+    vk::DeviceSize bytes_written;
+    uint32_t reallocations;
+};
+
+stream_buffer create_stream_buffer(const vk::Device &device, memory_arena &arena, vk::BufferUsageFlags usage, vk::DeviceSize capacity);
+// Starts a new frame, only call it once the frame that last used the buffer has finished on the GPU
+void stream_begin(stream_buffer &stream);
+// Makes sure the buffer holds at least size bytes, keeping what was already written this frame
+void stream_reserve(stream_buffer &stream, vk::DeviceSize size);
+void destroy_stream_buffer(stream_buffer &stream);
+
+// Hands out room for count elements, the returned offset is what gets bound
+template <typename T>
+T *stream_alloc(stream_buffer &stream, size_t count, vk::DeviceSize &offset)
+{
+    offset = (stream.bytes_written + alignof(T) - 1) / alignof(T) * alignof(T);
+    stream_reserve(stream, offset + sizeof(T) * count);
+    stream.bytes_written = offset + sizeof(T) * count;
+    return (T *)(stream.data + offset);
+}
@@ -0,0 +1,171 @@
+#include "swapchain.hpp"
+#include <algorithm>
+#include <print>
+
+bool parse_present_policy(std::string_view name, present_policy &policy)
+{
+    if (name == "fifo")
+        policy = present_policy::fifo;
+    else if (name == "relaxed")
+        policy = present_policy::fifo_relaxed;
+    else if (name == "mailbox")
+        policy = present_policy::mailbox;
+    else if (name == "immediate")
+        policy = present_policy::immediate;
+    else
+        return false;
+    return true;
+}
+
+static vk::PresentModeKHR choose_present_mode(const std::vector<vk::PresentModeKHR> &present_modes, present_policy policy)
+{
+    std::vector<vk::PresentModeKHR> preferred;
+    switch (policy)
+    {
+        case present_policy::immediate:
+            preferred = {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+            break;
+        case present_policy::mailbox:
+            preferred = {vk::PresentModeKHR::eMailbox};
+            break;
+        case present_policy::fifo_relaxed:
+            preferred = {vk::PresentModeKHR::eFifoRelaxed};
+            break;
+        case present_policy::fifo:
+            break;
+    }
+    for (auto mode: preferred)
+    {
+        if (std::find(present_modes.begin(), present_modes.end(), mode) != present_modes.end())
+            return mode;
+    }
+    // The only mode every implementation has to support
+    return vk::PresentModeKHR::eFifo;
+}
+
+// A minimized window has a 0x0 framebuffer and no swapchain can be made for it, sleep until it comes back
+static bool wait_for_drawable_window(GLFWwindow *window)
+{
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    while ((width == 0 || height == 0) && !glfwWindowShouldClose(window))
+    {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+    return !glfwWindowShouldClose(window);
+}
+
+static void build_swapchain(window_swapchain &swapchain, vk::SwapchainKHR old_swapchain)
+{
+    vk::SurfaceCapabilitiesKHR surface_capabilities = swapchain.physical_device.getSurfaceCapabilitiesKHR(swapchain.surface);
+    if (surface_capabilities.currentExtent.height == UINT32_MAX || surface_capabilities.currentExtent.width == UINT32_MAX)
+    {
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(swapchain.window, &width, &height);
+        swapchain.extent.width = std::clamp((uint32_t)width, surface_capabilities.minImageExtent.width, surface_capabilities.maxImageExtent.width);
+        swapchain.extent.height = std::clamp((uint32_t)height, surface_capabilities.minImageExtent.height, surface_capabilities.maxImageExtent.height);
+    }
+    else
+    {
+        swapchain.extent = surface_capabilities.currentExtent;
+    }
+
+    if (swapchain.format.format == vk::Format::eUndefined)
+    {
+        std::vector<vk::SurfaceFormatKHR> surface_formats = swapchain.physical_device.getSurfaceFormatsKHR(swapchain.surface);
+        swapchain.format = surface_formats[0];
+        for (auto form: surface_formats)
+        {
+            if (form.format == vk::Format::eB8G8R8A8Srgb && form.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear)
+            {
+                swapchain.format = form;
+                break;
+            }
+        }
+    }
+
+    swapchain.present_mode = choose_present_mode(swapchain.physical_device.getSurfacePresentModesKHR(swapchain.surface), swapchain.config.policy);
+    uint32_t image_count = swapchain.config.image_count;
+    if (image_count == 0)
+        image_count = swapchain.present_mode == vk::PresentModeKHR::eMailbox ? 3 : 2;
+    image_count = std::max(image_count, surface_capabilities.minImageCount);
+    if (surface_capabilities.maxImageCount > 0)
+        image_count = std::min(image_count, surface_capabilities.maxImageCount);
+
+    vk::SwapchainCreateInfoKHR swapchain_info = vk::SwapchainCreateInfoKHR(vk::SwapchainCreateFlagsKHR(), swapchain.surface, image_count, swapchain.format.format,
+                                                                            swapchain.format.colorSpace, swapchain.extent,
+                                                                            1, vk::ImageUsageFlagBits::eColorAttachment, vk::SharingMode::eExclusive);
+    swapchain_info.preTransform = surface_capabilities.currentTransform;
+    swapchain_info.presentMode = swapchain.present_mode;
+    swapchain_info.clipped = VK_TRUE;
+    // Lets the driver hand over resources from the old swapchain instead of starting from nothing
+    swapchain_info.oldSwapchain = old_swapchain;
+    swapchain_info.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+    swapchain.handle = swapchain.device.createSwapchainKHR(swapchain_info);
+
+    swapchain.images = swapchain.device.getSwapchainImagesKHR(swapchain.handle);
+    for (auto &image: swapchain.images)
+    {
+        vk::ImageViewCreateInfo image_view_info = {};
+        image_view_info.image = image;
+        image_view_info.viewType = vk::ImageViewType::e2D;
+        image_view_info.format = swapchain.format.format;
+        image_view_info.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        image_view_info.subresourceRange.levelCount = 1;
+        image_view_info.subresourceRange.layerCount = 1;
+        swapchain.views.push_back(swapchain.device.createImageView(image_view_info));
+        swapchain.render_semaphores.push_back(swapchain.device.createSemaphore(vk::SemaphoreCreateInfo()));
+    }
+    std::println("Swapchain {}x{} with {} images, present mode {}", swapchain.extent.width, swapchain.extent.height,
+                swapchain.images.size(), vk::to_string(swapchain.present_mode));
+}
+
+// Everything except the swapchain handle itself, which recreation still needs as oldSwapchain
+static void destroy_swapchain_resources(window_swapchain &swapchain)
+{
+    for (auto &view: swapchain.views)
+        swapchain.device.destroyImageView(view);
+    for (auto &semaphore: swapchain.render_semaphores)
+        swapchain.device.destroySemaphore(semaphore);
+    swapchain.views.clear();
+    swapchain.render_semaphores.clear();
+    swapchain.images.clear();
+}
+
+window_swapchain create_window_swapchain(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::SurfaceKHR surface,
+                                        GLFWwindow *window, const swapchain_config &config)
+{
+    window_swapchain swapchain{};
+    swapchain.device = device;
+    swapchain.physical_device = selected_physical_device;
+    swapchain.surface = surface;
+    swapchain.window = window;
+    swapchain.config = config;
+    wait_for_drawable_window(window);
+    build_swapchain(swapchain, nullptr);
+    return swapchain;
+}
+
+bool recreate_window_swapchain(window_swapchain &swapchain)
+{
+    if (!wait_for_drawable_window(swapchain.window))
+        return false;
+    // Resizes are rare, waiting for the GPU is simpler than tracking which frame still uses which image
+    swapchain.device.waitIdle();
+    destroy_swapchain_resources(swapchain);
+    vk::SwapchainKHR old_swapchain = swapchain.handle;
+    build_swapchain(swapchain, old_swapchain);
+    swapchain.device.destroySwapchainKHR(old_swapchain);
+    swapchain.recreations++;
+    return true;
+}
+
+void destroy_window_swapchain(window_swapchain &swapchain)
+{
+    destroy_swapchain_resources(swapchain);
+    swapchain.device.destroySwapchainKHR(swapchain.handle);
+    swapchain.handle = nullptr;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <GLFW/glfw3.h>
+#include <string_view>
+#include <vector>
+
+// Which present mode to ask for, falling back when the surface doesnt support it:
+// immediate -> mailbox -> fifo, mailbox -> fifo, fifo_relaxed -> fifo
+enum class present_policy
+{
+    fifo,
+    fifo_relaxed,
+    mailbox,
+    immediate
+};
+
+struct swapchain_config
+{
+    present_policy policy = present_policy::fifo_relaxed;
+    // 0 picks 3 for mailbox and 2 otherwise, always clamped to what the surface allows
+    uint32_t image_count = 0;
+};
+
+struct window_swapchain
+{
+    vk::Device device;
+    vk::PhysicalDevice physical_device;
+    vk::SurfaceKHR surface;
+    GLFWwindow *window;
+    swapchain_config config;
+
+    vk::SwapchainKHR handle;
+    vk::SurfaceFormatKHR format;
+    vk::PresentModeKHR present_mode;
+    vk::Extent2D extent;
+    std::vector<vk::Image> images;
+    std::vector<vk::ImageView> views;
+    // Signalled by the submit that renders an image and waited on by its present. One per image and not per
+    // frame in flight, a present can still be pending when the frame slot that signalled it comes round again
+    std::vector<vk::Semaphore> render_semaphores;
+    uint32_t recreations;
+};
+
+bool parse_present_policy(std::string_view name, present_policy &policy);
+window_swapchain create_window_swapchain(const vk::Device &device, vk::PhysicalDevice selected_physical_device, vk::SurfaceKHR surface,
+                                        GLFWwindow *window, const swapchain_config &config);
+// Builds a new swapchain from the old one after a resize or an out of date error. Waits while the window
+// is minimized, returns false if it got closed in the meantime
+bool recreate_window_swapchain(window_swapchain &swapchain);
+void destroy_window_swapchain(window_swapchain &swapchain);
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock free handoff of the latest value from one writer thread to one reader thread.
+// The writer always has a slot of its own to fill, publishing swaps it with the shared middle
+// slot and the reader swaps its slot with the middle one when something new was published
+template <typename T>
+struct triple_buffer
+{
+    static constexpr uint32_t index_mask = 3;
+    static constexpr uint32_t fresh_bit = 4;
+
+    T slots[3];
+    std::atomic<uint32_t> middle = 1;
+    uint32_t back = 0;  // writer only
+    uint32_t front = 2; // reader only
+
+    T &write_slot()
+    {
+        return slots[back];
+    }
+
+    void publish()
+    {
+        back = middle.exchange(back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // Returns true if a new value was picked up, read_slot keeps the last one otherwise
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & fresh_bit) == 0)
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    const T &read_slot() const
+    {
+        return slots[front];
+    }
+};
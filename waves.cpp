@@ -0,0 +1,75 @@
+#include "waves.hpp"
+
+enemy_archetype default_enemy_archetype()
+{
+    return {{0.05f, 0.4f}, {0.6f, 0.9f}, {0.5f, 1.5f}, {1.0f, 1.0f, 1.0f}};
+}
+
+wave_scheduler default_wave_schedule()
+{
+    enemy_archetype plain = default_enemy_archetype();
+    // Small and fast, they come in lines
+    enemy_archetype darts = {{0.05f, 0.12f}, {0.75f, 0.9f}, {1.4f, 2.0f}, {1.0f, 0.5f, 0.3f}};
+    // Big and slow
+    enemy_archetype walls = {{0.25f, 0.4f}, {0.6f, 0.7f}, {0.4f, 0.7f}, {0.4f, 0.6f, 1.0f}};
+
+    wave_scheduler scheduler{};
+    scheduler.waves = {
+        {0.0f, 1, 0.0f, true, plain},
+        {0.5f, 1, 0.0f, true, plain},
+        {0.5f, 1, 0.0f, true, plain},
+        {0.5f, 3, 0.6f, true, darts},
+        {1.0f, 1, 0.0f, true, walls},
+        {0.5f, 2, 1.2f, true, plain},
+    };
+    scheduler.growth = 1.25f;
+    scheduler.multiplier = 1.0f;
+    return scheduler;
+}
+
+bounding_box make_enemy_box(pcg32 &rng, const enemy_archetype &archetype, float x)
+{
+    bounding_box box{};
+    box.width = random_range(rng, archetype.size.x, archetype.size.y);
+    box.height = random_range(rng, archetype.size.x, archetype.size.y);
+    box.x = x;
+    box.y = random_range(rng, archetype.y.x, archetype.y.y);
+    box.velocityX = -random_range(rng, archetype.speed.x, archetype.speed.y);
+    return box;
+}
+
+uint32_t update_wave_scheduler(wave_scheduler &scheduler, float dt, pcg32 &rng, entity_pool &pool)
+{
+    if (scheduler.waves.empty())
+        return 0;
+    uint32_t spawned = 0;
+    scheduler.timer += dt;
+    for (size_t i = 0; i < scheduler.waves.size(); i++)
+    {
+        const spawn_wave &wave = scheduler.waves[scheduler.next_wave];
+        if (wave.after_clear && !pool.store.empty())
+        {
+            // The delay only starts counting once the field is clear
+            scheduler.timer = 0.0f;
+            break;
+        }
+        if (scheduler.timer < wave.delay)
+            break;
+        scheduler.timer -= wave.delay;
+
+        uint32_t count = (uint32_t)(wave.count * scheduler.multiplier);
+        for (uint32_t k = 0; k < count; k++)
+            spawn_entity(pool, make_enemy_box(rng, wave.archetype, 0.8f + k * wave.spacing), wave.archetype.color);
+        spawned += count;
+
+        scheduler.next_wave++;
+        if (scheduler.next_wave == scheduler.waves.size())
+        {
+            scheduler.next_wave = 0;
+            scheduler.rounds++;
+            scheduler.multiplier *= scheduler.growth;
+        }
+    }
+    scheduler.spawned += spawned;
+    return spawned;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "entities.hpp"
+#include "random.hpp"
+
+// What the enemies of a wave look like, every value is picked uniformly inside its range
+struct enemy_archetype
+{
+    glm::vec2 size;     // min, max for both width and height
+    glm::vec2 y;
+    glm::vec2 speed;    // leftwards
+    glm::vec3 color;
+};
+
+struct spawn_wave
+{
+    float delay;        // seconds after the previous wave went out (or after the field cleared)
+    uint32_t count;
+    float spacing;      // the wave comes in lined up this far apart from x = 0.8 rightwards
+    bool after_clear;   // hold the wave back until every enemy is gone
+    enemy_archetype archetype;
+};
+
+// Sends out waves in order, looping over them with growth times more enemies each round.
+// Spawning only appends to the pool, so a wave of thousands costs no allocations as long as the pool has room
+struct wave_scheduler
+{
+    std::vector<spawn_wave> waves;
+    size_t next_wave;
+    float timer;
+    float growth;
+    float multiplier;
+    uint32_t rounds;
+    uint64_t spawned;
+};
+
+enemy_archetype default_enemy_archetype();
+// The runner's waves: one box at a time at first, getting busier every round
+wave_scheduler default_wave_schedule();
+bounding_box make_enemy_box(pcg32 &rng, const enemy_archetype &archetype, float x);
+// Advances by dt and spawns whatever is due, each wave at most once per call. Returns how many were spawned
+uint32_t update_wave_scheduler(wave_scheduler &scheduler, float dt, pcg32 &rng, entity_pool &pool);